@@ -0,0 +1,200 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../CascLib/Casc/Common.hpp"
+#include "../CascLib/Casc/Exceptions.hpp"
+
+const char* usageText =
+"Usage: casc-benchmark [<location>]\n\n"
+"<location>     - path to a game directory to time opening, optional";
+
+// The number of times each benchmark runs. The fastest run is reported.
+const int Runs = 5;
+
+/**
+ * Reads an integer one byte at a time, the way Endian::read did before it loaded whole values.
+ */
+template <typename T, Casc::IO::EndianType Type = Casc::IO::EndianType::Big>
+T readBytes(const char *first, const char *last)
+{
+    T output = 0;
+
+    for (auto it = first; it != last; ++it)
+    {
+        auto shift = Type == Casc::IO::EndianType::Big ? (last - first - 1) - (it - first) : it - first;
+        output |= static_cast<T>(static_cast<uint8_t>(*it)) << shift * 8;
+    }
+
+    return output;
+}
+
+/**
+ * Parses the entries of an .idx file the way Index did before Reference::parseEntries:
+ * one Reference at a time, appended to the table, with every field read one byte at a time.
+ */
+void parseEntriesByBytes(const char *entries, size_t count, std::vector<Casc::Parsers::Binary::Reference> &out)
+{
+    out.clear();
+    out.reserve(count);
+
+    for (auto entry = entries; entry != entries + count * 18; entry += 18)
+    {
+        auto file = readBytes<size_t, Casc::IO::EndianType::Little>(entry + 9, entry + 10);
+        auto offset = readBytes<size_t>(entry + 10, entry + 14);
+        auto size = readBytes<size_t, Casc::IO::EndianType::Little>(entry + 14, entry + 18);
+
+        // The bits of the offset field above the 30 segment bits belong to the file number.
+        file = file << 2 | offset >> 30;
+        offset &= (size_t(1) << 30) - 1U;
+
+        out.emplace_back(entry, entry + 9, file, offset, size);
+    }
+}
+
+/**
+ * Runs a function several times and returns the time of the fastest run in nanoseconds per item.
+ */
+template <typename Function>
+double measure(size_t items, Function fn)
+{
+    auto best = std::chrono::nanoseconds::max();
+
+    for (int i = 0; i < Runs; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+        best = std::min(best, time);
+    }
+
+    return double(best.count()) / items;
+}
+
+/**
+ * Prints the times of a benchmark and how much faster the second one is.
+ */
+void report(const std::string &name, double before, double after)
+{
+    std::cout << name << ": " << before << " ns -> " << after << " ns per item (" << before / after << "x)" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 2)
+    {
+        std::cout << usageText << std::endl;
+        return 0;
+    }
+
+    std::mt19937 random(42);
+    std::vector<char> data(64U << 20);
+
+    for (auto &byte : data)
+    {
+        byte = char(random());
+    }
+
+    // Big endian 32-bit fields, as in the encoding pages and BLTE block tables.
+    {
+        auto count = data.size() / sizeof(uint32_t);
+        uint32_t sum = 0;
+
+        auto before = measure(count, [&]()
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto field = data.data() + i * sizeof(uint32_t);
+                sum += readBytes<uint32_t>(field, field + sizeof(uint32_t));
+            }
+        });
+
+        auto after = measure(count, [&]()
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                sum += Casc::IO::Endian::read<Casc::IO::EndianType::Big, uint32_t>(data.data() + i * sizeof(uint32_t));
+            }
+        });
+
+        report("Endian::read<Big, uint32_t>", before, after);
+        std::cout << "  (checksum " << sum << ")" << std::endl;
+    }
+
+    // Entries of an .idx file with the usual layout.
+    {
+        auto count = data.size() / 18;
+        std::vector<Casc::Parsers::Binary::Reference> baseline;
+        std::vector<Casc::Parsers::Binary::Reference> refs(count);
+
+        auto before = measure(count, [&]()
+        {
+            parseEntriesByBytes(data.data(), count, baseline);
+        });
+
+        auto after = measure(count, [&]()
+        {
+            Casc::Parsers::Binary::Reference::parseEntries(data.data(), count, 9, 5, 4, 30, refs.data());
+        });
+
+        if (!std::equal(baseline.begin(), baseline.end(), refs.begin(), refs.end(),
+            [](const Casc::Parsers::Binary::Reference &a, const Casc::Parsers::Binary::Reference &b)
+            {
+                return a.key() == b.key() && a.file() == b.file() && a.offset() == b.offset() && a.size() == b.size();
+            }))
+        {
+            std::cout << "Reference::parseEntries doesn't match the byte by byte parse." << std::endl;
+            return -1;
+        }
+
+        report("Reference::parseEntries vs emplace_back and byte reads", before, after);
+        std::cout << "  (checksum " << refs.back().offset() << ")" << std::endl;
+    }
+
+    if (argc > 1)
+    {
+        try
+        {
+            for (int i = 0; i < Runs; ++i)
+            {
+                auto container = std::make_unique<Casc::Container>(argv[1], "Data");
+                auto timings = container->timings();
+
+                std::cout << "Container: " << timings.total.count() / 1000 << " us"
+                    << " (index " << timings.index.count() / 1000 << " us"
+                    << ", encoding " << timings.encoding.count() / 1000 << " us"
+                    << ", root " << timings.root.count() / 1000 << " us)" << std::endl;
+            }
+        }
+        catch (Casc::Exceptions::CascException &ex)
+        {
+            std::cout << "Failed to open the CASC container (" << ex.what() << ")." << std::endl;
+            return -1;
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
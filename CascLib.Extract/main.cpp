@@ -49,11 +49,11 @@ int main(int argc, char* argv[])
             
             if (strcmp(argv[2], "key") == 0)
             {
-                file = container->openFileByKey(std::string(argv[3]));
+                file = container->openFileByKey(Casc::Key(argv[3]));
             }
             else if (strcmp(argv[2], "hash") == 0)
             {
-                file = container->openFileByHash(std::string(argv[3]));
+                file = container->openFileByHash(Casc::Key(argv[3]));
             }
             else if (strcmp(argv[2], "filename") == 0)
             {
@@ -141,6 +141,15 @@ int main(int argc, char* argv[])
 
             ss << "Couldn't find a file with the given filename (" << ex.filename << ").";
 
+            std::cout << ss.str() << std::endl;
+            return -1;
+        }
+        catch (Casc::Exceptions::ParserException &ex)
+        {
+            std::stringstream ss;
+
+            ss << "Invalid key (" << ex.what() << ").";
+
             std::cout << ss.str() << std::endl;
             return -1;
         }
@@ -3,6 +3,7 @@
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
+#include <deque>
 #include <fstream>
 #include <memory>
 #include <thread>
@@ -13,6 +14,7 @@ using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 #include "../CascLib/Casc/IO/Buffer.hpp"
 #include "../CascLib/Casc/IO/Stream.hpp"
 #include "../CascLib/Casc/Common.hpp"
+#include "../CascLib/Casc/Parsers/Binary/Reference.hpp"
 
 using namespace Casc;
  
@@ -22,6 +24,50 @@ namespace CascLibTest
     std::vector<char> noneData;
     std::vector<char> zData;
 
+    /**
+     * Builds an encoding file. Each page is padded with zeros and gets its first key and checksum from its content.
+     */
+    std::vector<uint8_t> encodingFile(uint8_t hashSizeA, uint8_t hashSizeB, uint16_t pageSize, const std::string &strings,
+        const std::vector<std::vector<uint8_t>> &pagesA, const std::vector<std::vector<uint8_t>> &pagesB, const std::string &profile)
+    {
+        std::vector<uint8_t> file = { 'E', 'N', 1, hashSizeA, hashSizeB };
+
+        auto append = [&](const auto &bytes) { file.insert(file.end(), bytes.begin(), bytes.end()); };
+
+        append(IO::Endian::write<IO::EndianType::Big, uint16_t>(pageSize));
+        append(IO::Endian::write<IO::EndianType::Big, uint16_t>(pageSize));
+        append(IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(pagesA.size())));
+        append(IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(pagesB.size())));
+        file.push_back(0);
+        append(IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(strings.size())));
+        file.insert(file.end(), strings.begin(), strings.end());
+
+        auto table = [&](const std::vector<std::vector<uint8_t>> &pages, size_t keyOffset, size_t keySize)
+        {
+            std::vector<uint8_t> data;
+
+            for (auto &page : pages)
+            {
+                auto padded = page;
+                padded.resize(pageSize * 1024U);
+
+                auto checksum = Crypto::MD5(padded.begin(), padded.end()).digest();
+                file.insert(file.end(), padded.begin() + keyOffset, padded.begin() + keyOffset + keySize);
+                file.insert(file.end(), checksum.begin(), checksum.end());
+                data.insert(data.end(), padded.begin(), padded.end());
+            }
+
+            append(data);
+        };
+
+        table(pagesA, 6, hashSizeA);
+        table(pagesB, 0, hashSizeB);
+
+        file.insert(file.end(), profile.begin(), profile.end());
+
+        return file;
+    }
+
 	TEST_CLASS(CascLibTests)
 	{
 	public:
@@ -72,7 +118,8 @@ namespace CascLibTest
                 std::vector<char>{ noneData.begin() + 60 + chunk.offset, noneData.begin() + 60 + chunk.offset + chunk.size });
             auto handler = std::make_shared<IO::Impl::NoneHandler>(chunk, source);
 
-            auto decoded = handler->decode(0, chunk.size - 1);
+            std::vector<char> decoded(chunk.size - 1);
+            handler->decode(0, { decoded.data(), decoded.size() });
 
             auto equal = std::memcmp(decoded.data(), noneData.data() + 60 + chunk.offset + 1, chunk.size - 1);
             Assert::AreEqual(0, equal);
@@ -92,13 +139,55 @@ namespace CascLibTest
                 std::vector<char>{ zData.begin() + 36 + chunk.offset, zData.begin() + 36 + chunk.offset + chunk.size });
             auto handler = std::make_shared<IO::Impl::ZlibHandler>(chunk, source);
 
-            auto decoded = handler->decode(0, chunk.end - chunk.begin);
-            decoded = handler->decode(0, chunk.end - chunk.begin);
+            std::vector<char> decoded(chunk.end - chunk.begin);
+            handler->decode(0, { decoded.data(), decoded.size() });
+            handler->decode(0, { decoded.data(), decoded.size() });
 
             auto equal = std::memcmp(decoded.data(), noneData.data() + 60 + chunk.offset + 1, chunk.end - chunk.begin);
             Assert::AreEqual(0, equal);
         }
 
+        TEST_METHOD(ZlibHandlerIncremental)
+        {
+            std::vector<char> data(200000);
+
+            for (size_t i = 0; i < data.size(); ++i)
+            {
+                data[i] = char('a' + (i * i) % 26);
+            }
+
+            IO::Chunk empty { 0, 0, 0, 0 };
+            auto encoded = IO::Impl::ZlibHandler(empty, nullptr).encode(data);
+
+            IO::Chunk chunk
+            {
+                0,
+                data.size(),
+                0,
+                encoded.size()
+            };
+
+            auto source = std::make_shared<IO::Impl::MemoryMappedSource>(std::move(encoded));
+            auto handler = std::make_shared<IO::Impl::ZlibHandler>(chunk, source);
+
+            // Sequential reads resume where the previous one stopped.
+            std::vector<char> decoded(data.size());
+
+            for (size_t offset = 0; offset < data.size(); offset += 777)
+            {
+                auto count = std::min<size_t>(777, data.size() - offset);
+                auto n = handler->decode(offset, { decoded.data() + offset, count });
+                Assert::AreEqual(count, n);
+            }
+
+            auto equal = std::memcmp(decoded.data(), data.data(), data.size());
+            Assert::AreEqual(0, equal);
+
+            // A view never extends past the end of the chunk.
+            auto view = handler->view(data.size() - 10, SIZE_MAX);
+            Assert::AreEqual(size_t(10), view.size());
+        }
+
         TEST_METHOD(NoneHandlerWithStream)
         {
             IO::Chunk chunk
@@ -113,7 +202,8 @@ namespace CascLibTest
             auto source = std::make_shared<IO::Impl::StreamSource>(stream, std::make_pair(65U, 70U));
             auto handler = std::make_shared<IO::Impl::NoneHandler>(chunk, source);
 
-            auto decoded = handler->decode(0, chunk.size - 1);
+            std::vector<char> decoded(chunk.size - 1);
+            handler->decode(0, { decoded.data(), decoded.size() });
 
             auto equal = std::memcmp(decoded.data(), noneData.data() + 60 + chunk.offset + 1, chunk.size - 1);
             Assert::AreEqual(0, equal);
@@ -134,8 +224,9 @@ namespace CascLibTest
 
             auto handler = std::make_shared<IO::Impl::ZlibHandler>(chunk, source);
 
-            auto decoded = handler->decode(0, chunk.end - chunk.begin);
-            decoded = handler->decode(0, chunk.end - chunk.begin);
+            std::vector<char> decoded(chunk.end - chunk.begin);
+            handler->decode(0, { decoded.data(), decoded.size() });
+            handler->decode(0, { decoded.data(), decoded.size() });
 
             auto equal = std::memcmp(decoded.data(), noneData.data() + 60 + chunk.offset + 1, chunk.end - chunk.begin);
             Assert::AreEqual(0, equal);
@@ -148,6 +239,414 @@ namespace CascLibTest
             Assert::AreEqual(2U, chunks.size());
         }
 
+        TEST_METHOD(ParseReference)
+        {
+            // Data file 5 at offset 0x02345678. The low bits of the file number are stored above the 30 offset bits.
+            std::vector<char> entry = { '\x01', '\x02', '\x03', '\x04', '\x05', '\x06', '\x07', '\x08', '\x09',
+                '\x01', '\x42', '\x34', '\x56', '\x78', '\xE8', '\x03', '\x00', '\x00' };
+
+            Parsers::Binary::Reference ref(entry.begin(), entry.end(), 9, 5, 4, 30);
+
+            Assert::AreEqual(size_t(5), ref.file());
+            Assert::AreEqual(size_t(0x02345678), ref.offset());
+            Assert::AreEqual(size_t(1000), ref.size());
+            Assert::AreEqual(0, std::memcmp(ref.key().data(), entry.data(), 9));
+            Assert::AreEqual(size_t(18), sizeof(Parsers::Binary::Reference));
+        }
+
+        TEST_METHOD(ParseReferenceEntries)
+        {
+            std::vector<char> entries(18 * 37);
+
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                entries[i] = char(i * 131 + 7);
+            }
+
+            std::vector<Parsers::Binary::Reference> refs(37);
+            std::pair<uint32_t, uint32_t> hash{ 0, 0 };
+            Parsers::Binary::Reference::parseEntries(entries.data(), refs.size(), 9, 5, 4, 30, refs.data(), &hash);
+
+            // The entries are hashed one at a time, the way the .idx checksum chains them.
+            std::pair<uint32_t, uint32_t> expectedHash{ 0, 0 };
+
+            for (auto entry = entries.begin(); entry != entries.end(); entry += 18)
+            {
+                expectedHash = Crypto::lookup3(entry, entry + 18, expectedHash);
+            }
+
+            Assert::IsTrue(expectedHash == hash);
+
+            for (size_t i = 0; i < refs.size(); ++i)
+            {
+                auto entry = entries.begin() + 18 * i;
+                Parsers::Binary::Reference expected(entry, entry + 18, 9, 5, 4, 30);
+
+                Assert::AreEqual(expected.file(), refs[i].file());
+                Assert::AreEqual(expected.offset(), refs[i].offset());
+                Assert::AreEqual(expected.size(), refs[i].size());
+                Assert::IsTrue(expected.key() == refs[i].key());
+            }
+
+            // Loads from contiguous bytes match reads byte by byte.
+            std::deque<char> bytes(entries.begin(), entries.begin() + 8);
+            Assert::AreEqual(IO::Endian::read<IO::EndianType::Big, uint64_t>(bytes.begin(), bytes.end()),
+                IO::Endian::read<IO::EndianType::Big, uint64_t>(entries.data()));
+            Assert::AreEqual(IO::Endian::read<IO::EndianType::Little, uint32_t>(bytes.begin(), bytes.begin() + 4),
+                IO::Endian::read<IO::EndianType::Little, uint32_t>(entries.begin()));
+        }
+
+        TEST_METHOD(ParseBuildInfo)
+        {
+            std::string text = "Branch!STRING:0|Build Key!HEX:16|Version!STRING:0\r\n"
+                "eu|3cd47e9aa62341ac89c5aef6dc0dd80f|7.0.3.22810\r\n"
+                "us||7.0.3.22811";
+
+            std::fstream fs;
+            fs.open("build.info", std::ios_base::out | std::ios_base::binary);
+            fs.write(text.data(), text.size());
+            fs.close();
+
+            Parsers::Text::BuildInfo buildInfo("build.info");
+            std::experimental::filesystem::remove("build.info");
+
+            Assert::AreEqual(2, buildInfo.size());
+            Assert::AreEqual(std::string("3cd47e9aa62341ac89c5aef6dc0dd80f"), buildInfo.build(0).at("Build Key").string());
+            Assert::AreEqual(std::string("7.0.3.22810"), buildInfo.build(0).at("Version").string());
+            Assert::AreEqual(std::string("7.0.3.22811"), buildInfo.build(1).at("Version").string());
+            Assert::IsTrue(buildInfo.build(1).at("Build Key").empty());
+            Assert::ExpectException<std::out_of_range>([&]() { buildInfo.build(0).at("CDN Key"); });
+        }
+
+        TEST_METHOD(ParseConfiguration)
+        {
+            std::string key(300, 'k');
+
+            auto text = "# Build Configuration\n\n"
+                "root = 0123456789abcdef0123456789abcdef\n"
+                "encoding = 00112233445566778899aabbccddeeff 0123456789abcdef0123456789abcdef\n"
+                " ffeeddccbbaa99887766554433221100\n" + key + " = value\n";
+
+            std::fstream fs;
+            fs.open("config", std::ios_base::out | std::ios_base::binary);
+            fs.write(text.data(), text.size());
+            fs.close();
+
+            Parsers::Text::Configuration configuration(std::make_shared<std::ifstream>("config", std::ios_base::in | std::ios_base::binary));
+            std::experimental::filesystem::remove("config");
+
+            Assert::AreEqual(size_t(1), configuration["root"].size());
+            Assert::AreEqual(size_t(3), configuration["encoding"].size());
+            Assert::AreEqual(std::string("ffeeddccbbaa99887766554433221100"), configuration["encoding"].back().string());
+            Assert::IsTrue(Key("0123456789abcdef0123456789abcdef") == Key(configuration["root"].front()));
+            Assert::AreEqual(std::string("value"), configuration[key].front().string());
+        }
+
+        TEST_METHOD(ParseShadowMemory)
+        {
+            auto append = [](std::vector<char> &data, uint32_t value)
+            {
+                auto bytes = IO::Endian::write<IO::EndianType::Little>(value);
+                data.insert(data.end(), bytes.begin(), bytes.end());
+            };
+
+            // A header listing one free space block, followed by the versions of the 16 buckets.
+            std::vector<char> data;
+            append(data, 4);
+            append(data, 264 + 8 + 16 * 4);
+            data.resize(264);
+            append(data, 32 + 1090 * 5 * 2);
+            append(data, 264 + 8 + 16 * 4);
+
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                append(data, 0x10 + i);
+            }
+
+            // The free space block, with two entries.
+            auto block = data.size();
+            append(data, 1);
+            append(data, 2);
+            data.resize(block + 32 + 1090 * 5 * 2);
+
+            const char entry[] = { '\x01', '\x40', '\x00', '\x00', '\x20' };
+            std::copy(entry, entry + 5, data.begin() + block + 32 + 5);
+            std::copy(entry, entry + 5, data.begin() + block + 32 + 1090 * 5);
+
+            Parsers::Binary::ShadowMemory shadowMemory(IO::Span<const char>(data.data(), data.size()));
+
+            Assert::AreEqual(size_t(16), shadowMemory.versions().size());
+            Assert::AreEqual(0x1FU, shadowMemory.versions().at(15));
+            Assert::AreEqual(size_t(2), shadowMemory.freeSpaceLengths().size());
+            Assert::AreEqual(uint64_t(0x140000020), shadowMemory.freeSpaceLengths()[1]);
+            Assert::AreEqual(uint64_t(0x140000020), shadowMemory.freeSpaceOffsets()[0]);
+            Assert::AreEqual(uint64_t(0), shadowMemory.freeSpaceOffsets()[1]);
+
+            data.resize(data.size() - 1);
+            Assert::ExpectException<Exceptions::ParserException>([&]() { Parsers::Binary::ShadowMemory truncated(IO::Span<const char>(data.data(), data.size())); });
+        }
+
+        TEST_METHOD(EncodingPages)
+        {
+            auto key = [](size_t n, uint8_t tail)
+            {
+                std::vector<uint8_t> key(16);
+                key[0] = uint8_t(n + 1);
+                key[15] = tail;
+
+                return key;
+            };
+
+            // 30 content records of 38 bytes, 20 to a page.
+            std::vector<std::vector<uint8_t>> pagesA(2);
+
+            for (size_t j = 0; j < 30; ++j)
+            {
+                auto &page = pagesA[j / 20];
+                auto hash = key(j, 0xBB);
+                auto encoded = key(j, 0xAA);
+                auto size = IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(j * 10));
+
+                page.insert(page.end(), { 1, 0 });
+                page.insert(page.end(), size.begin(), size.end());
+                page.insert(page.end(), hash.begin(), hash.end());
+                page.insert(page.end(), encoded.begin(), encoded.end());
+            }
+
+            // 50 encoded records of 25 bytes. 40 fill the first page but its last 24 bytes, and every third has no profile.
+            std::vector<std::vector<uint8_t>> pagesB(2);
+
+            for (size_t i = 0; i < 50; ++i)
+            {
+                auto &page = pagesB[i / 40];
+                auto encoded = key(i, 0xAA);
+                auto profile = IO::Endian::write<IO::EndianType::Big, uint32_t>(i % 3 == 0 ? 0xFFFFFFFF : uint32_t(i % 2));
+                auto size = IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(i * 100));
+
+                page.insert(page.end(), encoded.begin(), encoded.end());
+                page.insert(page.end(), profile.begin(), profile.end());
+                page.push_back(0);
+                page.insert(page.end(), size.begin(), size.end());
+            }
+
+            auto file = encodingFile(16, 16, 1, std::string("n\0z\0", 4), pagesA, pagesB, "b:{*=z}");
+
+            Parsers::Binary::Encoding encoding(std::make_shared<const std::vector<uint8_t>>(file));
+
+            for (size_t i = 0; i < 50; ++i)
+            {
+                auto encoded = key(i, 0xAA);
+                auto info = encoding.findEncodedFileInfo(Key(encoded.begin(), encoded.end()));
+
+                Assert::AreEqual(i * 100, info.size);
+                Assert::AreEqual(std::string(i % 3 == 0 ? "" : i % 2 == 0 ? "n" : "z"), info.params);
+            }
+
+            for (size_t j = 0; j < 30; ++j)
+            {
+                auto hash = key(j, 0xBB);
+                auto encoded = key(j, 0xAA);
+                auto info = encoding.findFileInfo(Key(hash.begin(), hash.end()));
+
+                Assert::AreEqual(j * 10, info.size);
+                Assert::AreEqual(size_t(1), info.keys.size());
+                Assert::IsTrue(info.keys[0] == Key(encoded.begin(), encoded.end()));
+            }
+
+            Assert::AreEqual(size_t(30), encoding.listFileInfo(0, 100).size());
+            Assert::AreEqual(size_t(50), encoding.listEncodedFileInfo(0, 100).size());
+
+            // Before the first page, past the last record of a full page, and in the padding of the last page.
+            for (auto missing : { key(size_t(-1), 0xAA), key(39, 0xAB), key(60, 0xAA) })
+            {
+                Assert::ExpectException<Exceptions::KeyDoesNotExistException>([&]() { encoding.findEncodedFileInfo(Key(missing.begin(), missing.end())); });
+            }
+
+            auto missing = key(19, 0xBC);
+            Assert::ExpectException<Exceptions::HashDoesNotExistException>([&]() { encoding.findFileInfo(Key(missing.begin(), missing.end())); });
+
+            // A damaged page only fails the lookups that land in it, every time.
+            auto damaged = file;
+            damaged[damaged.size() - 8] ^= 1;
+
+            Parsers::Binary::Encoding bad(std::make_shared<const std::vector<uint8_t>>(damaged));
+
+            auto first = key(0, 0xAA);
+            auto last = key(49, 0xAA);
+
+            Assert::AreEqual(size_t(0), bad.findEncodedFileInfo(Key(first.begin(), first.end())).size);
+            Assert::ExpectException<Exceptions::InvalidHashException>([&]() { bad.findEncodedFileInfo(Key(last.begin(), last.end())); });
+            Assert::ExpectException<Exceptions::InvalidHashException>([&]() { bad.findEncodedFileInfo(Key(last.begin(), last.end())); });
+        }
+
+        TEST_METHOD(ParseEncoding)
+        {
+            // 9-byte encoding keys and 2 KB pages, with one record that uses the profile of the encoding file itself.
+            std::vector<uint8_t> hash(16, 0x11), encoded(9, 0x22);
+            std::vector<uint8_t> fileInfo = { 1, 0, 0, 0, 0x12, 0x34 };
+            fileInfo.insert(fileInfo.end(), hash.begin(), hash.end());
+            fileInfo.insert(fileInfo.end(), encoded.begin(), encoded.end());
+
+            std::vector<std::vector<uint8_t>> pagesB;
+
+            for (uint8_t i = 0; i < 3; ++i)
+            {
+                std::vector<uint8_t> record(9, uint8_t(0x22 + i));
+                record.insert(record.end(), { 0, 0, 0, i, 1, 0, 0, 0, i });
+                pagesB.push_back(record);
+            }
+
+            auto file = encodingFile(16, 9, 2, std::string("n\0z,zstd\0", 9), { fileInfo }, pagesB, "b:{*=z}");
+
+            Parsers::Binary::Encoding encoding(std::make_shared<const std::vector<uint8_t>>(file));
+
+            auto info = encoding.findFileInfo(Key(hash.begin(), hash.end()));
+
+            Assert::AreEqual(size_t(0x1234), info.size);
+            Assert::IsTrue(info.keys.size() == 1 && info.keys[0] == Key(encoded.begin(), encoded.end()));
+
+            std::string params[] = { "n", "z,zstd", "b:{*=z}" };
+
+            for (uint8_t i = 0; i < 3; ++i)
+            {
+                std::vector<uint8_t> key(9, uint8_t(0x22 + i));
+                auto encodedInfo = encoding.findEncodedFileInfo(Key(key.begin(), key.end()));
+
+                Assert::AreEqual(size_t((uint64_t(1) << 32) + i), encodedInfo.size);
+                Assert::AreEqual(params[i], encodedInfo.params);
+            }
+
+            // Cut anywhere but in the trailing profile, the file is rejected.
+            for (auto size : { size_t(0), size_t(21), size_t(25), size_t(40), file.size() - 8 - 2048 })
+            {
+                auto truncated = std::make_shared<const std::vector<uint8_t>>(file.begin(), file.begin() + size);
+
+                Assert::ExpectException<Exceptions::ParserException>([&]() { Parsers::Binary::Encoding encoding(truncated); });
+            }
+
+            std::vector<uint8_t> last(9, 0x24);
+            Parsers::Binary::Encoding withoutProfile(std::make_shared<const std::vector<uint8_t>>(file.begin(), file.end() - 7));
+
+            Assert::AreEqual(std::string(), withoutProfile.findEncodedFileInfo(Key(last.begin(), last.end())).params);
+
+            auto unsupported = file;
+            unsupported[4] = 17;
+
+            Assert::ExpectException<Exceptions::ParserException>([&]() { Parsers::Binary::Encoding encoding(std::make_shared<const std::vector<uint8_t>>(unsupported)); });
+        }
+
+        TEST_METHOD(KeyCompare)
+        {
+            Key key("0123456789abcdef0123456789abcdef");
+
+            Assert::AreEqual(std::string("0123456789abcdef0123456789abcdef"), key.string());
+            Assert::AreEqual(std::string("0123456789abcdef01"), IndexKey(key).string());
+            Assert::IsTrue(IndexKey::prefix("0123456789abcdef0123456789abcdef") == IndexKey(key));
+
+            // Only exactly 2 * Size hex digits parse as a key.
+            for (auto hex : { "", "garbage", "0123456789abcdef0123456789abcde", "0123456789abcdef0123456789abcdef0",
+                "0123456789abcdef0123456789abcdeg", "0123456789abcdef 0123456789abcde" })
+            {
+                Assert::ExpectException<Exceptions::ParserException>([&]() { Key{ hex }; });
+            }
+
+            Assert::ExpectException<Exceptions::ParserException>([&]() { IndexKey::prefix("0123456789abcdef0"); });
+            Assert::AreEqual(size_t(16), sizeof(Key));
+
+            // The order has to match the order of the raw bytes for every position that differs.
+            for (size_t i = 0; i < Key::size(); ++i)
+            {
+                for (auto value : { 0x00, 0x01, 0x7F, 0x80, 0xFF })
+                {
+                    Key other = key;
+                    other.data()[i] = uint8_t(value);
+
+                    auto expected = std::memcmp(key.data(), other.data(), Key::size());
+                    auto actual = Key::compare(key, other);
+
+                    Assert::IsTrue((expected < 0) == (actual < 0) && (expected > 0) == (actual > 0));
+                    Assert::IsTrue((key < other) == (expected < 0));
+                    Assert::IsTrue((key == other) == (expected == 0));
+                }
+            }
+        }
+
+        TEST_METHOD(Snapshot)
+        {
+            Key id("00112233445566778899aabbccddeeff");
+
+            std::vector<uint32_t> numbers = { 1, 2, 3, 5, 8, 13 };
+            std::vector<Key> keys = { Key("0123456789abcdef0123456789abcdef"), Key("456789abcdef0123456789abcdef0123") };
+
+            {
+                IO::SnapshotWriter writer("snapshot.bin");
+                writer.add(IO::Span<const uint32_t>(numbers.data(), numbers.size()));
+                writer.add(IO::Span<const Key>(keys.data(), keys.size()));
+                writer.add(uint64_t(42));
+                writer.commit(id);
+            }
+
+            auto snapshot = IO::Snapshot::open("snapshot.bin", id);
+            Assert::IsTrue(snapshot != nullptr);
+
+            auto readNumbers = snapshot->next<uint32_t>();
+            Assert::IsTrue(std::equal(numbers.begin(), numbers.end(), readNumbers.begin()) && readNumbers.size() == numbers.size());
+
+            auto readKeys = snapshot->next<Key>();
+            Assert::IsTrue(readKeys.size() == 2 && readKeys[1] == keys[1]);
+
+            Assert::AreEqual(uint64_t(42), snapshot->nextValue<uint64_t>());
+            Assert::ExpectException<Exceptions::ParserException>([&]() { snapshot->next<char>(); });
+
+            // A snapshot of something else, or no snapshot at all, isn't used.
+            Assert::IsTrue(IO::Snapshot::open("snapshot.bin", Key("ff112233445566778899aabbccddeeff")) == nullptr);
+            Assert::IsTrue(IO::Snapshot::open("missing.bin", id) == nullptr);
+
+            snapshot = nullptr;
+            std::experimental::filesystem::remove("snapshot.bin");
+        }
+
+        TEST_METHOD(WoWRootLocales)
+        {
+            std::string path("WORLD\\MAPS\\AZEROTH.WDT");
+            auto name = Crypto::lookup3(path);
+
+            std::vector<char> data;
+
+            auto append = [&](uint32_t value)
+            {
+                auto bytes = IO::Endian::write<IO::EndianType::Little, uint32_t>(value);
+                data.insert(data.end(), bytes.begin(), bytes.end());
+            };
+
+            // The same name in a German and an American block.
+            for (auto locale : { uint32_t(Filesystem::deDE), uint32_t(Filesystem::enUS) })
+            {
+                append(1);
+                append(0);
+                append(locale);
+                append(0);
+                data.insert(data.end(), 16, char(locale));
+                append(name.second);
+                append(name.first);
+            }
+
+            Filesystem::Impl::WoWHandler all(data);
+            Filesystem::Impl::WoWHandler enUS(data, Filesystem::enUS);
+            Filesystem::Impl::WoWHandler deDE(data, Filesystem::deDE);
+            Filesystem::Impl::WoWHandler both(data, Filesystem::deDE | Filesystem::enUS);
+
+            Assert::AreEqual(uint8_t(Filesystem::enUS), enUS.findHash("world/maps/azeroth.wdt")[0]);
+            Assert::AreEqual(uint8_t(Filesystem::deDE), deDE.findHash(path)[0]);
+
+            // The records are split between threads, and the first one in the file still wins.
+            Assert::AreEqual(uint8_t(Filesystem::deDE), both.findHash(path)[0]);
+
+            // Every block is kept unless the locales are narrowed.
+            Assert::AreEqual(uint8_t(Filesystem::deDE), all.findHash(path)[0]);
+            Assert::ExpectException<Exceptions::FilenameDoesNotExistException>([&]() { enUS.findHash("WORLD\\MAPS\\KALIMDOR.WDT"); });
+        }
+
         TEST_METHOD(BufferWithNoneHandlers)
         {
             IO::Buffer b;
@@ -162,6 +661,318 @@ namespace CascLibTest
             Assert::AreEqual(0, equal);
         }
 
+        TEST_METHOD(NoneHandlerView)
+        {
+            IO::Chunk chunk
+            {
+                4,
+                8,
+                5,
+                5
+            };
+
+            auto source = std::make_shared<IO::Impl::MemoryMappedSource>(
+                std::vector<char>{ noneData.begin() + 60 + chunk.offset, noneData.begin() + 60 + chunk.offset + chunk.size });
+            auto handler = std::make_shared<IO::Impl::NoneHandler>(chunk, source);
+
+            auto view = handler->view(1, chunk.size);
+
+            Assert::AreEqual(chunk.size - 2, view.size());
+
+            auto equal = std::memcmp(view.data(), noneData.data() + 60 + chunk.offset + 2, view.size());
+            Assert::AreEqual(0, equal);
+        }
+
+        TEST_METHOD(BufferWithMappedFile)
+        {
+            std::vector<char> data(30, '\0');
+            data[16] = char(data.size() + noneData.size());
+            data.insert(data.end(), noneData.begin(), noneData.end());
+
+            std::fstream fs;
+            fs.open("mapped.bin", std::ios_base::out | std::ios_base::binary);
+            fs.write(data.data(), data.size());
+            fs.close();
+
+            {
+                IO::Buffer b;
+                b.open(std::make_shared<IO::MappedFile>("mapped.bin"), 0);
+
+                char arr[8];
+
+                b.sgetn(arr, 8);
+                auto equal = std::memcmp(arr, noneData.data() + 60 + 1, 4);
+                Assert::AreEqual(0, equal);
+                equal = std::memcmp(arr + 4, noneData.data() + 60 + 6, 4);
+                Assert::AreEqual(0, equal);
+            }
+
+            std::experimental::filesystem::remove("mapped.bin");
+        }
+
+        TEST_METHOD(BufferWithFile)
+        {
+            std::vector<char> data(30, '\0');
+            data[16] = char(data.size() + noneData.size());
+            data.insert(data.end(), noneData.begin(), noneData.end());
+
+            std::fstream fs;
+            fs.open("file.bin", std::ios_base::out | std::ios_base::binary);
+            fs.write(data.data(), data.size());
+            fs.close();
+
+            {
+                auto file = std::make_shared<IO::File>("file.bin");
+
+                IO::Buffer b;
+                b.open(file, 0);
+
+                char arr[8];
+
+                b.sgetn(arr, 8);
+                auto equal = std::memcmp(arr, noneData.data() + 60 + 1, 4);
+                Assert::AreEqual(0, equal);
+                equal = std::memcmp(arr + 4, noneData.data() + 60 + 6, 4);
+                Assert::AreEqual(0, equal);
+
+                // The same descriptor serves a second buffer, which reads the whole file at once.
+                IO::Buffer c;
+                c.open(file, 0, data.size());
+
+                c.sgetn(arr, 8);
+                equal = std::memcmp(arr, noneData.data() + 60 + 1, 4);
+                Assert::AreEqual(0, equal);
+            }
+
+            std::experimental::filesystem::remove("file.bin");
+        }
+
+        TEST_METHOD(FileConcurrentReads)
+        {
+            std::vector<char> data(1 << 16);
+
+            for (size_t i = 0; i < data.size(); ++i)
+            {
+                data[i] = char(i * 7 + (i >> 8));
+            }
+
+            std::fstream fs;
+            fs.open("concurrent.bin", std::ios_base::out | std::ios_base::binary);
+            fs.write(data.data(), data.size());
+            fs.close();
+
+            {
+                IO::File file("concurrent.bin");
+
+                std::vector<std::thread> threads;
+                std::vector<int> results(8, -1);
+
+                for (size_t t = 0; t < results.size(); ++t)
+                {
+                    threads.emplace_back([&, t]()
+                    {
+                        std::vector<char> out(1000);
+                        auto equal = 0;
+
+                        for (size_t offset = t * 97; offset + out.size() <= data.size() && equal == 0; offset += 4099)
+                        {
+                            file.read(offset, { out.data(), out.size() });
+                            equal = std::memcmp(out.data(), data.data() + offset, out.size());
+                        }
+
+                        results[t] = equal;
+                    });
+                }
+
+                for (auto &thread : threads)
+                {
+                    thread.join();
+                }
+
+                for (auto result : results)
+                {
+                    Assert::AreEqual(0, result);
+                }
+            }
+
+            std::experimental::filesystem::remove("concurrent.bin");
+        }
+
+        TEST_METHOD(ChunkCacheScanResistance)
+        {
+            IO::ChunkCache cache(10 * 1000, 1);
+
+            auto chunk = [](size_t n) { return std::make_shared<const std::vector<char>>(1000, char(n)); };
+            auto key = [](size_t n) { return IO::ChunkCache::Key{ {}, n }; };
+
+            cache.insert(key(0), chunk(0));
+            Assert::IsTrue(cache.find(key(0)) != nullptr);
+
+            // A scan over many chunks that are only used once.
+            for (size_t i = 1; i < 100; ++i)
+            {
+                cache.insert(key(i), chunk(i));
+            }
+
+            Assert::IsTrue(cache.find(key(0)) != nullptr);
+            Assert::IsTrue(cache.find(key(1)) == nullptr);
+            Assert::IsTrue(cache.size() <= 10 * 1000);
+        }
+
+        TEST_METHOD(BufferWithChunkCache)
+        {
+            std::vector<char> content(100000);
+
+            for (size_t i = 0; i < content.size(); ++i)
+            {
+                content[i] = char('a' + (i * i) % 26);
+            }
+
+            IO::Chunk empty{ 0, 0, 0, 0 };
+            auto encoded = IO::Impl::ZlibHandler(empty, nullptr).encode(content);
+
+            std::vector<char> data(30, '\0');
+            data[0] = 0x42;
+            data.insert(data.end(), { 'B', 'L', 'T', 'E', 0, 0, 0, 36, 0x0F, 0, 0, 1 });
+            auto physicalSize = IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(encoded.size()));
+            auto logicalSize = IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(content.size()));
+            data.insert(data.end(), physicalSize.begin(), physicalSize.end());
+            data.insert(data.end(), logicalSize.begin(), logicalSize.end());
+            data.insert(data.end(), 16, '\0');
+            data.insert(data.end(), encoded.begin(), encoded.end());
+
+            std::fstream fs;
+            fs.open("cached.bin", std::ios_base::out | std::ios_base::binary);
+            fs.write(data.data(), data.size());
+            fs.close();
+
+            {
+                auto file = std::make_shared<IO::File>("cached.bin");
+                auto cache = std::make_shared<IO::ChunkCache>(16 << 20);
+
+                for (auto i = 0; i < 2; ++i)
+                {
+                    IO::Buffer b;
+                    b.setCache(cache);
+                    b.open(file, 0);
+
+                    std::vector<char> decoded(content.size());
+                    auto n = b.sgetn(decoded.data(), decoded.size());
+
+                    Assert::AreEqual(content.size(), size_t(n));
+                    Assert::AreEqual(0, std::memcmp(decoded.data(), content.data(), content.size()));
+                    Assert::AreEqual(content.size(), cache->size());
+                }
+            }
+
+            std::experimental::filesystem::remove("cached.bin");
+        }
+
+        TEST_METHOD(MD5)
+        {
+            Assert::AreEqual(std::string("d41d8cd98f00b204e9800998ecf8427e"), Crypto::MD5(std::string()).hexdigest());
+            Assert::AreEqual(std::string("900150983cd24fb0d6963f7d28e17f72"), Crypto::MD5(std::string("abc")).hexdigest());
+            Assert::AreEqual(std::string("57edf4a22be3c955ac49da2e2107b67a"),
+                Crypto::MD5(std::string("12345678901234567890123456789012345678901234567890123456789012345678901234567890")).hexdigest());
+
+            std::vector<char> input(1000);
+
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                input[i] = char(i * 7);
+            }
+
+            Crypto::MD5 split;
+
+            for (size_t offset = 0, step = 1; offset < input.size(); offset += step, step = step * 2 + 1)
+            {
+                split.update(input.data() + offset, std::min(step, input.size() - offset));
+            }
+
+            Assert::IsTrue(Crypto::MD5(input).digest() == split.digest());
+        }
+
+        TEST_METHOD(BufferVerification)
+        {
+            std::vector<char> content(100000);
+
+            for (size_t i = 0; i < content.size(); ++i)
+            {
+                content[i] = char('a' + (i * i) % 26);
+            }
+
+            IO::Chunk empty{ 0, 0, 0, 0 };
+            auto encoded = IO::Impl::ZlibHandler(empty, nullptr).encode(content);
+
+            std::vector<char> header = { 'B', 'L', 'T', 'E', 0, 0, 0, 36, 0x0F, 0, 0, 1 };
+            auto physicalSize = IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(encoded.size()));
+            auto logicalSize = IO::Endian::write<IO::EndianType::Big, uint32_t>(uint32_t(content.size()));
+            auto checksum = Crypto::MD5(encoded).digest();
+            header.insert(header.end(), physicalSize.begin(), physicalSize.end());
+            header.insert(header.end(), logicalSize.begin(), logicalSize.end());
+            header.insert(header.end(), checksum.begin(), checksum.end());
+
+            auto key = Crypto::MD5(header).digest();
+
+            std::vector<char> data(key.rbegin(), key.rend());
+            data.resize(30, '\0');
+            data.insert(data.end(), header.begin(), header.end());
+            data.insert(data.end(), encoded.begin(), encoded.end());
+
+            auto corrupt = data;
+            corrupt.back() ^= 1;
+
+            std::fstream fs;
+            fs.open("verified.bin", std::ios_base::out | std::ios_base::binary);
+            fs.write(data.data(), data.size());
+            fs.write(corrupt.data(), corrupt.size());
+            fs.close();
+
+            {
+                auto file = std::make_shared<IO::File>("verified.bin");
+
+                IO::Buffer b;
+                b.setVerification(IO::VerificationMode::Eager);
+                b.open(file, 0);
+
+                std::vector<char> decoded(content.size());
+
+                Assert::AreEqual(content.size(), size_t(b.sgetn(decoded.data(), decoded.size())));
+                Assert::AreEqual(0, std::memcmp(decoded.data(), content.data(), content.size()));
+
+                // Lazily checked chunks are only hashed when they're first read.
+                b.setVerification(IO::VerificationMode::Lazy);
+                b.open(file, data.size());
+
+                Assert::ExpectException<Exceptions::InvalidHashException>([&]() { b.sgetn(decoded.data(), decoded.size()); });
+
+                b.setVerification(IO::VerificationMode::Eager);
+
+                Assert::ExpectException<Exceptions::InvalidHashException>([&]() { b.open(file, data.size()); });
+            }
+
+            {
+                auto file = std::make_shared<IO::File>("verified.bin");
+                auto cache = std::make_shared<IO::ChunkCache>(16 << 20);
+
+                IO::Buffer b;
+                b.setCache(cache);
+                b.setVerification(IO::VerificationMode::Lazy);
+                b.open(file, 0);
+
+                std::vector<char> decoded(content.size());
+                b.sgetn(decoded.data(), decoded.size());
+
+                // Both copies have the same key, so the corrupt one is served from the cache without being read or hashed.
+                b.open(file, data.size());
+
+                Assert::AreEqual(content.size(), size_t(b.sgetn(decoded.data(), decoded.size())));
+                Assert::AreEqual(0, std::memcmp(decoded.data(), content.data(), content.size()));
+            }
+
+            std::experimental::filesystem::remove("verified.bin");
+        }
+
         TEST_METHOD(GetFileSize)
         {
             IO::Buffer b;
@@ -242,7 +1053,7 @@ namespace CascLibTest
             Parsers::Text::Configuration configuration(
                 alloc.config<true, false>(buildInfo.build(0).at("Build Key")));
 
-            auto file = container->openFileByKey(configuration["encoding"].back());
+            auto file = container->openFileByKey(Key(configuration["encoding"].back()));
 
             file->seekg(0, std::ios_base::end);
             auto size = file->tellg();
@@ -274,7 +1085,7 @@ namespace CascLibTest
             Parsers::Text::Configuration configuration(
                 alloc.config<true, false>(buildInfo.build(0).at("Build Key")));
 
-			auto file = container->openFileByHash(configuration["root"].front());
+			auto file = container->openFileByHash(Key(configuration["root"].front()));
             //auto file = container->openFileByHash("948c12c5b95d8ea92ebf3dc1af003792");
             
             file->seekg(0, std::ios_base::end);
@@ -337,5 +1148,33 @@ namespace CascLibTest
             delete[] arr;
         }
 
+        TEST_METHOD(GetFilesByName)
+        {
+            auto container = std::make_unique<Container>(
+                R"(I:\World of Warcraft)",
+                R"(Data)");
+
+            std::vector<std::string> paths = {
+                "SPELLS\\BONE_CYCLONE_STATE.M2",
+                "INTERFACE\\GLUES\\MODELS\\UI_MAINMENU\\UI_MAINMENU.M2",
+                "SPELLS\\BONE_CYCLONE_STATE.M2"
+            };
+
+            auto files = container->readFilesByName(paths);
+
+            Assert::AreEqual(paths.size(), files.size());
+
+            // The files come back in the order they were asked for, whatever order they were read in.
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                auto file = container->openFileByName(paths[i]);
+
+                std::vector<char> expected(files[i].size());
+                file->read(expected.data(), expected.size());
+
+                Assert::IsTrue(expected == files[i]);
+            }
+        }
+
 	};
 }
\ No newline at end of file
@@ -24,23 +24,32 @@
 #else
 #include <boost/filesystem.hpp>
 #endif
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <locale>
+#include <mutex>
 #include <numeric>
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "Common.hpp"
+#include "ContainerOptions.hpp"
 #include "Exceptions.hpp"
 
 #include "md5.hpp"
 
+#include "Crypto/MD5.hpp"
+
 #include "Filesystem/Root.hpp"
 #include "IO/Handler.hpp"
 #include "IO/Stream.hpp"
+#include "IO/Snapshot.hpp"
 #include "IO/StreamAllocator.hpp"
 #include "Parsers/Text/BuildInfo.hpp"
 #include "Parsers/Text/Configuration.hpp"
@@ -61,24 +70,117 @@ namespace Casc
         typedef std::pair<Parsers::Text::EncodingBlock, std::vector<char>> descriptor_type;
 
     public:
-        std::shared_ptr<IO::Stream> openFileByKey(Hex key) const
+        std::shared_ptr<IO::Stream> openFileByKey(const Key &key) const
         {
             return allocator->data(findFileLocation(key));
         }
 
-        std::shared_ptr<IO::Stream> openFileByHash(Hex hash) const
+        std::shared_ptr<IO::Stream> openFileByHash(const Key &hash) const
         {
-            auto fi = encoding->findFileInfo(hash);
-            auto enc = encoding->findEncodedFileInfo(fi.keys.at(0));
-            return openFileByKey(enc.key);
+            auto key = getEncoding().viewFileInfo(hash).key(0);
+            return allocator->data(index->find(IndexKey(key)));
         }
 
         std::shared_ptr<IO::Stream> openFileByName(std::string path) const
         {
-            auto hash = root->find(path);
+            auto hash = getRoot().find(path);
             return openFileByHash(hash);
         }
 
+        /**
+         * Opens several files by encoding key. The files are opened in the order they're stored in,
+         * and the streams are returned in the order of the keys.
+         */
+        std::vector<std::shared_ptr<IO::Stream>> openFilesByKey(const std::vector<Key> &keys) const
+        {
+            return openFiles(findFileLocations(keys,
+                [this](const Key &key) { return findFileLocation(key); }));
+        }
+
+        /**
+         * Opens several files by content hash. The files are opened in the order they're stored in,
+         * and the streams are returned in the order of the hashes.
+         */
+        std::vector<std::shared_ptr<IO::Stream>> openFilesByHash(const std::vector<Key> &hashes) const
+        {
+            return openFiles(findFileLocations(hashes,
+                [this](const Key &hash) { return findFileLocation(getEncoding().viewFileInfo(hash).key(0)); }));
+        }
+
+        /**
+         * Opens several files by name. The files are opened in the order they're stored in,
+         * and the streams are returned in the order of the names.
+         */
+        std::vector<std::shared_ptr<IO::Stream>> openFilesByName(const std::vector<std::string> &paths) const
+        {
+            return openFiles(findFileLocations(paths,
+                [this](const std::string &path) { return findFileLocation(getEncoding().viewFileInfo(getRoot().find(path)).key(0)); }));
+        }
+
+        /**
+         * Reads several whole files by encoding key. The files are read in the order they're stored in,
+         * so the reads are close to sequential, and returned in the order of the keys.
+         */
+        std::vector<std::vector<char>> readFilesByKey(const std::vector<Key> &keys) const
+        {
+            return readFiles(findFileLocations(keys,
+                [this](const Key &key) { return findFileLocation(key); }));
+        }
+
+        /**
+         * Reads several whole files by content hash. The files are read in the order they're stored in,
+         * so the reads are close to sequential, and returned in the order of the hashes.
+         */
+        std::vector<std::vector<char>> readFilesByHash(const std::vector<Key> &hashes) const
+        {
+            return readFiles(findFileLocations(hashes,
+                [this](const Key &hash) { return findFileLocation(getEncoding().viewFileInfo(hash).key(0)); }));
+        }
+
+        /**
+         * Reads several whole files by name. The files are read in the order they're stored in,
+         * so the reads are close to sequential, and returned in the order of the names.
+         */
+        std::vector<std::vector<char>> readFilesByName(const std::vector<std::string> &paths) const
+        {
+            return readFiles(findFileLocations(paths,
+                [this](const std::string &path) { return findFileLocation(getEncoding().viewFileInfo(getRoot().find(path)).key(0)); }));
+        }
+
+        /**
+         * How long each stage of opening the container took. Stages that ran at the same time overlap,
+         * so they can add up to more than the total.
+         */
+        struct Timings
+        {
+            // Reading the build info.
+            std::chrono::nanoseconds buildInfo{};
+
+            // Reading the build configuration.
+            std::chrono::nanoseconds buildConfig{};
+
+            // Reading the CDN configuration.
+            std::chrono::nanoseconds cdnConfig{};
+
+            // Reading the shadow memory.
+            std::chrono::nanoseconds shadowMemory{};
+
+            // Mapping the snapshot, or writing it when there wasn't a usable one.
+            std::chrono::nanoseconds snapshot{};
+
+            // Parsing the .idx files.
+            std::chrono::nanoseconds index{};
+
+            // Loading the encoding file. Zero until first use when the container is lazy.
+            std::chrono::nanoseconds encoding{};
+
+            // Loading the root file. Zero until first use when the container is lazy.
+            std::chrono::nanoseconds root{};
+
+            // Opening the container, from start to end.
+            std::chrono::nanoseconds total{};
+        };
+
     private:
         static const int BlteSignature = 0x45544C42;
         static const int DataHeaderSize = 30U;
@@ -104,41 +206,467 @@ namespace Casc
         // The shadow memory.
         Parsers::Binary::ShadowMemory shadowMemory;
 
+        // The snapshot the tables below were read from, if any. Dropped if a table can't be read from it.
+        mutable std::shared_ptr<IO::Snapshot> snapshot;
+
         // The file indices.
         std::shared_ptr<Parsers::Binary::Index> index;
 
-        // The encoding file.
-        std::shared_ptr<Parsers::Binary::Encoding> encoding;
+        // The encoding file. Loaded on first use when the container is lazy.
+        mutable std::shared_ptr<Parsers::Binary::Encoding> encoding;
+
+        // Filesystem root. Loaded on first use when the container is lazy.
+        mutable std::shared_ptr<Filesystem::Root> root;
+
+        // Guards loading the encoding file on first use.
+        std::unique_ptr<std::once_flag> encodingLoaded;
 
-        // Filesystem root.
-        std::shared_ptr<Filesystem::Root> root;
+        // Guards loading the root file on first use.
+        std::unique_ptr<std::once_flag> rootLoaded;
+
+        // The options the container was opened with.
+        ContainerOptions options;
+
+        // How long each stage of opening the container took.
+        mutable Timings timings_;
+
+        // Guards the timings of the stages that are loaded on first use.
+        std::unique_ptr<std::mutex> timingsLock;
+
+        /**
+         * The encoding file, loaded if it hasn't been.
+         */
+        const Parsers::Binary::Encoding &getEncoding() const
+        {
+            std::call_once(*encodingLoaded, [this]()
+            {
+                if (encoding == nullptr)
+                {
+                    std::chrono::nanoseconds time;
+                    encoding = timed(time, [this]() { return loadEncoding(buildConfig, index, snapshot, allocator); });
+
+                    std::lock_guard<std::mutex> lock(*timingsLock);
+                    timings_.encoding = time;
+                }
+            });
+
+            return *encoding;
+        }
+
+        /**
+         * The filesystem root, loaded if it hasn't been.
+         */
+        const Filesystem::Root &getRoot() const
+        {
+            // The root is read after the encoding file, both from the root's dependencies and from the snapshot.
+            getEncoding();
+
+            std::call_once(*rootLoaded, [this]()
+            {
+                if (root == nullptr)
+                {
+                    std::chrono::nanoseconds time;
+                    root = timed(time, [this]() { return loadRoot(buildConfig, index, encoding, snapshot, allocator, options); });
+
+                    std::lock_guard<std::mutex> lock(*timingsLock);
+                    timings_.root = time;
+                }
+            });
+
+            return *root;
+        }
 
         /**
          * Finds the location of a file.
          */
-        Parsers::Binary::Reference findFileLocation(Hex key) const
+        Parsers::Binary::Reference findFileLocation(const Key &key) const
+        {
+            return index->find(IndexKey(key));
+        }
+
+        /**
+         * Finds the locations of several files.
+         */
+        template <typename T, typename Function>
+        static std::vector<Parsers::Binary::Reference> findFileLocations(const std::vector<T> &items, Function find)
         {
-            return index->find(key.begin(), key.begin() + 9);
+            std::vector<Parsers::Binary::Reference> refs;
+            refs.reserve(items.size());
+
+            for (auto &item : items)
+            {
+                refs.push_back(find(item));
+            }
+
+            return refs;
+        }
+
+        /**
+         * Orders the locations of several files by data file and offset.
+         * Returns the indices of the locations in that order.
+         */
+        static std::vector<size_t> physicalOrder(const std::vector<Parsers::Binary::Reference> &refs)
+        {
+            std::vector<size_t> order(refs.size());
+            std::iota(order.begin(), order.end(), size_t(0));
+
+            std::stable_sort(order.begin(), order.end(), [&refs](size_t a, size_t b)
+            {
+                return std::make_pair(refs[a].file(), refs[a].offset()) < std::make_pair(refs[b].file(), refs[b].offset());
+            });
+
+            return order;
+        }
+
+        /**
+         * Opens several files in the order they're stored in.
+         */
+        std::vector<std::shared_ptr<IO::Stream>> openFiles(const std::vector<Parsers::Binary::Reference> &refs) const
+        {
+            std::vector<std::shared_ptr<IO::Stream>> streams(refs.size());
+
+            for (auto i : physicalOrder(refs))
+            {
+                streams[i] = allocator->data(refs[i]);
+            }
+
+            return streams;
+        }
+
+        /**
+         * Reads several whole files in the order they're stored in.
+         */
+        std::vector<std::vector<char>> readFiles(const std::vector<Parsers::Binary::Reference> &refs) const
+        {
+            std::vector<std::vector<char>> files(refs.size());
+
+            auto pattern = allocator->accessPattern() == IO::AccessPattern::Once ?
+                IO::AccessPattern::Once : IO::AccessPattern::Sequential;
+
+            for (auto i : physicalOrder(refs))
+            {
+                auto stream = allocator->data(refs[i], pattern);
+
+                stream->seekg(0, std::ios_base::end);
+                files[i].resize(size_t(stream->tellg()));
+                stream->seekg(0, std::ios_base::beg);
+
+                stream->read(files[i].data(), files[i].size());
+
+                if (size_t(stream->gcount()) != files[i].size())
+                {
+                    throw Exceptions::IOException("Couldn't read the file.");
+                }
+            }
+
+            return files;
+        }
+
+        /**
+         * The parts of a container, loaded before the container is constructed from them.
+         */
+        struct Parts
+        {
+            // The path of the game directory.
+            std::string path;
+
+            // The relative path of the data directory.
+            std::string dataPath;
+
+            // The stream allocator.
+            std::shared_ptr<IO::StreamAllocator> allocator;
+
+            // The build info.
+            std::shared_ptr<Parsers::Text::BuildInfo> buildInfo;
+
+            // The build configuration.
+            std::shared_ptr<Parsers::Text::Configuration> buildConfig;
+
+            // The CDN configuration.
+            std::shared_ptr<Parsers::Text::Configuration> cdnConfig;
+
+            // The shadow memory.
+            std::shared_ptr<Parsers::Binary::ShadowMemory> shadowMemory;
+
+            // The snapshot the tables were read from, if any.
+            std::shared_ptr<IO::Snapshot> snapshot;
+
+            // The file indices.
+            std::shared_ptr<Parsers::Binary::Index> index;
+
+            // The encoding file.
+            std::shared_ptr<Parsers::Binary::Encoding> encoding;
+
+            // The filesystem root.
+            std::shared_ptr<Filesystem::Root> root;
+
+            // How long each stage took. Shared with the stages, which may run on other threads.
+            std::shared_ptr<Timings> timings;
+
+            // When loading started.
+            std::chrono::steady_clock::time_point start;
+        };
+
+        /**
+         * Runs a stage and records how long it took.
+         */
+        template <typename Function>
+        static auto timed(std::chrono::nanoseconds &time, Function fn) -> decltype(fn())
+        {
+            auto start = std::chrono::steady_clock::now();
+            auto result = fn();
+            time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+            return result;
+        }
+
+        /**
+         * Identifies what a snapshot is made from: the build, the .idx files and the root filters.
+         */
+        static Key snapshotId(const Parsers::Text::BuildInfo &buildInfo,
+            const Parsers::Binary::ShadowMemory &shadowMemory, const ContainerOptions &options)
+        {
+            Crypto::MD5 hash;
+
+            auto build = buildInfo.build(0).at("Build Key");
+            hash.update(build.data(), build.size());
+
+            for (auto &version : shadowMemory.versions())
+            {
+                uint32_t fields[] = { version.first, version.second };
+                hash.update(fields, sizeof(fields));
+            }
+
+            uint32_t filters[] = { options.locales, options.excludedContentFlags };
+            hash.update(filters, sizeof(filters));
+
+            auto digest = hash.digest();
+
+            return Key(digest.begin(), digest.end());
+        }
+
+        /**
+         * Reads a table from the snapshot if there is one, or parses it from the game files.
+         * A snapshot that doesn't parse is dropped, so the tables after it are parsed too and it's written again.
+         */
+        template <typename FromSnapshot, typename FromFiles>
+        static auto loadTable(std::shared_ptr<IO::Snapshot> &snapshot, FromSnapshot fromSnapshot, FromFiles fromFiles)
+            -> decltype(fromFiles())
+        {
+            if (snapshot != nullptr)
+            {
+                try
+                {
+                    return fromSnapshot(*snapshot);
+                }
+                catch (const Exceptions::ParserException &)
+                {
+                    snapshot = nullptr;
+                }
+            }
+
+            return fromFiles();
+        }
+
+        /**
+         * Loads the encoding file, from the snapshot if there is one.
+         */
+        static std::shared_ptr<Parsers::Binary::Encoding> loadEncoding(const Parsers::Text::Configuration &buildConfig,
+            const std::shared_ptr<Parsers::Binary::Index> &index, std::shared_ptr<IO::Snapshot> &snapshot,
+            const std::shared_ptr<IO::StreamAllocator> &allocator)
+        {
+            return loadTable(snapshot,
+                [](IO::Snapshot &tables) { return std::make_shared<Parsers::Binary::Encoding>(tables); },
+                [&]() { return std::make_shared<Parsers::Binary::Encoding>(index->find(IndexKey::prefix(buildConfig["encoding"].back())), allocator); });
+        }
+
+        /**
+         * Loads the filesystem root, from the snapshot if there is one. The snapshot has to be past the encoding file.
+         */
+        static std::shared_ptr<Filesystem::Root> loadRoot(const Parsers::Text::Configuration &buildConfig,
+            const std::shared_ptr<Parsers::Binary::Index> &index, const std::shared_ptr<Parsers::Binary::Encoding> &encoding,
+            std::shared_ptr<IO::Snapshot> &snapshot, const std::shared_ptr<IO::StreamAllocator> &allocator,
+            const ContainerOptions &options)
+        {
+            auto game = getProgramCode(buildConfig["build-uid"].front());
+
+            return loadTable(snapshot,
+                [&](IO::Snapshot &tables) { return std::make_shared<Filesystem::Root>(game, tables); },
+                [&]() { return std::make_shared<Filesystem::Root>(game, Key(buildConfig["root"].front()),
+                    encoding, index, allocator, options.locales, options.excludedContentFlags); });
+        }
+
+        /**
+         * Loads the parts of a container. Each stage starts as soon as the stages it needs are done,
+         * so the stages that don't depend on each other run at the same time:
+         *
+         *   build info ----> build config ------------------.
+         *                `-> CDN config                      >--> encoding --> root
+         *   shadow memory --> snapshot --> index -----------'
+         *
+         * A lazy container leaves out the encoding and root files, which are loaded on first use instead.
+         *
+         * The stages capture what they use by value, so none of them can outlive what it refers to.
+         */
+        static Parts load(const std::string &path, const std::string &dataPath, const ContainerOptions &options)
+        {
+            using namespace Parsers;
+
+            Parts parts;
+            parts.path = path;
+            parts.dataPath = dataPath;
+            parts.start = std::chrono::steady_clock::now();
+            parts.timings = std::make_shared<Timings>();
+            parts.allocator = std::make_shared<IO::StreamAllocator>(path + PathSeparator + dataPath, options);
+
+            auto allocator = parts.allocator;
+            auto timings = parts.timings;
+
+            auto buildInfo = std::async(std::launch::async, [timings, path]()
+            {
+                return timed(timings->buildInfo, [&]() { return std::make_shared<Text::BuildInfo>(path + PathSeparator + ".build.info"); });
+            }).share();
+
+            auto buildConfig = std::async(std::launch::async, [timings, allocator, buildInfo]()
+            {
+                auto key = buildInfo.get()->build(0).at("Build Key");
+
+                return timed(timings->buildConfig, [&]() { return std::make_shared<Text::Configuration>(allocator->config<true, false>(key)); });
+            }).share();
+
+            auto cdnConfig = std::async(std::launch::async, [timings, allocator, buildInfo]()
+            {
+                auto key = buildInfo.get()->build(0).at("CDN Key");
+
+                return timed(timings->cdnConfig, [&]() { return std::make_shared<Text::Configuration>(allocator->config<true, false>(key)); });
+            }).share();
+
+            auto shadowMemory = std::async(std::launch::async, [timings, allocator]()
+            {
+                return timed(timings->shadowMemory, [&]() { return std::make_shared<Binary::ShadowMemory>(allocator->shmem<true, false>()); });
+            }).share();
+
+            auto snapshot = std::async(std::launch::async, [timings, options, buildInfo, shadowMemory]()
+            {
+                auto info = buildInfo.get();
+                auto memory = shadowMemory.get();
+
+                return timed(timings->snapshot, [&]()
+                {
+                    return options.snapshot.empty() ? nullptr : IO::Snapshot::open(options.snapshot, snapshotId(*info, *memory, options));
+                });
+            }).share();
+
+            // Returns the snapshot too, since it's dropped if the index can't be read from it.
+            auto index = std::async(std::launch::async, [timings, allocator, shadowMemory, snapshot]()
+            {
+                auto memory = shadowMemory.get();
+                auto tables = snapshot.get();
+
+                auto index = timed(timings->index, [&]()
+                {
+                    return loadTable(tables,
+                        [](IO::Snapshot &tables) { return std::make_shared<Binary::Index>(tables); },
+                        [&]() { return std::make_shared<Binary::Index>(memory->versions(), allocator); });
+                });
+
+                return std::make_pair(index, tables);
+            }).share();
+
+            // The last stages each need the one before, so they run here.
+            parts.buildInfo = buildInfo.get();
+            parts.buildConfig = buildConfig.get();
+            parts.shadowMemory = shadowMemory.get();
+            parts.index = index.get().first;
+            parts.snapshot = index.get().second;
+
+            if (!options.lazy)
+            {
+                parts.encoding = timed(timings->encoding, [&]()
+                {
+                    return loadEncoding(*parts.buildConfig, parts.index, parts.snapshot, allocator);
+                });
+
+                parts.root = timed(timings->root, [&]()
+                {
+                    return loadRoot(*parts.buildConfig, parts.index, parts.encoding, parts.snapshot, allocator, options);
+                });
+            }
+
+            parts.cdnConfig = cdnConfig.get();
+
+            return parts;
+        }
+
+        /**
+         * Constructor. Takes over loaded parts.
+         */
+        Container(Parts &&parts, const ContainerOptions &options) :
+            path(std::move(parts.path)),
+            dataPath(std::move(parts.dataPath)),
+            allocator(std::move(parts.allocator)),
+            buildInfo(std::move(*parts.buildInfo)),
+            buildConfig(std::move(*parts.buildConfig)),
+            cdnConfig(std::move(*parts.cdnConfig)),
+            shadowMemory(std::move(*parts.shadowMemory)),
+            snapshot(std::move(parts.snapshot)),
+            index(std::move(parts.index)),
+            encoding(std::move(parts.encoding)),
+            root(std::move(parts.root)),
+            encodingLoaded(new std::once_flag),
+            rootLoaded(new std::once_flag),
+            options(options),
+            timings_(*parts.timings),
+            timingsLock(new std::mutex)
+        {
+            // A lazy container doesn't have all the tables, so only an eager one writes the snapshot.
+            if (snapshot == nullptr && !options.snapshot.empty() && !options.lazy)
+            {
+                timed(timings_.snapshot, [&]()
+                {
+                    // The snapshot only speeds up the next open, so failing to write it isn't an error.
+                    try
+                    {
+                        IO::SnapshotWriter writer(options.snapshot);
+
+                        index->save(writer);
+                        encoding->save(writer);
+                        root->save(writer);
+
+                        writer.commit(snapshotId(buildInfo, shadowMemory, options));
+                    }
+                    catch (const Exceptions::IOException &)
+                    {
+                    }
+
+                    return true;
+                });
+            }
+
+            timings_.total = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - parts.start);
         }
 
     public:
         /**
          * Constructor.
          */
-        Container(const std::string path, const std::string dataPath) :
-            allocator(new IO::StreamAllocator(path + "\\" + dataPath)),
-            buildInfo(path + "\\.build.info"),
-            buildConfig(allocator->config<true, false>(buildInfo.build(0).at("Build Key"))),
-            cdnConfig(allocator->config<true, false>(buildInfo.build(0).at("CDN Key"))),
-            shadowMemory(allocator->shmem<true, false>()),
-            index(new Parsers::Binary::Index(shadowMemory.versions(), allocator)),
-            encoding(new Parsers::Binary::Encoding(
-                index->find(Hex(buildConfig["encoding"].back().substr(0, 18U))), allocator)),
-            root(new Filesystem::Root(getProgramCode(buildConfig["build-uid"].front()),
-                buildConfig["root"].front(), encoding, index, allocator))
+        Container(const std::string path, const std::string dataPath,
+            const ContainerOptions &options = ContainerOptions()) :
+            Container(load(path, dataPath, options), options)
         {
         }
 
+        /**
+         * How long each stage of opening the container took. A copy, since a lazy container
+         * fills in the encoding and root timings when they're first used, possibly on another thread.
+         */
+        Timings timings() const
+        {
+            std::lock_guard<std::mutex> lock(*timingsLock);
+
+            return timings_;
+        }
+
         /**
          * Move constructor.
          */
@@ -0,0 +1,72 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+#include "Filesystem/Locales.hpp"
+#include "IO/AccessPattern.hpp"
+#include "IO/FilePool.hpp"
+#include "IO/VerificationMode.hpp"
+
+namespace Casc
+{
+    /**
+     * Tunables for a container.
+     */
+    struct ContainerOptions
+    {
+        // Map the data files instead of reading them through file descriptors.
+        bool mapped = sizeof(void*) >= 8;
+
+        // The maximum number of data files kept open.
+        size_t maxOpenFiles = IO::FilePool::DefaultCapacity;
+
+        // The byte budget of the decoded chunk cache shared by all streams. Zero disables the cache.
+        size_t chunkCacheSize = 64U << 20;
+
+        // The refill size of a stream when data has to be copied. Zero matches the size of the chunk being read.
+        size_t bufferSize = 0;
+
+        // When the checksums of the files are checked. Off unless asked for: a checked chunk is hashed and,
+        // unless the file is mapped, read whole into memory instead of inflated as it's read.
+        IO::VerificationMode verification = IO::VerificationMode::None;
+
+        // How the files opened through the container are read, passed on to the OS. Loading always reads sequentially,
+        // and the batch reads read sequentially unless this is Once.
+        IO::AccessPattern access = IO::AccessPattern::Normal;
+
+        // The path of a snapshot of the parsed index, encoding and root tables, or empty for none.
+        // The snapshot is mapped when it was made from the same build and .idx files, and written otherwise.
+        std::string snapshot;
+
+        // Load the encoding and root files on first use instead of when the container is opened. Containers that are
+        // only read by encoding key never load them.
+        bool lazy = false;
+
+        // The locales to look names up in. A name in several of them resolves to the first variant in the root file.
+        // All of them by default; pick the installed locale, e.g. Filesystem::enUS, to resolve names to its variants.
+        uint32_t locales = Filesystem::AllLocales;
+
+        // The content flags of the root blocks to leave out of name lookups, e.g. Filesystem::LowViolence. None by default.
+        uint32_t excludedContentFlags = 0;
+    };
+}
\ No newline at end of file
@@ -19,12 +19,303 @@
 
 #pragma once
 
-#include "../md5.hpp"
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <stdint.h>
+#include <string>
 
 namespace Casc
 {
     namespace Crypto
     {
+        /**
+         * MD5 (RFC 1321). Hashes whole 64-byte blocks straight from the input
+         * and only buffers the tail that doesn't fill a block.
+         */
+        class MD5
+        {
+        public:
+            typedef std::array<uint8_t, 16> digest_type;
+
+        private:
+            static const size_t BlockSize = 64U;
+
+            // The digest so far.
+            uint32_t state[4];
+
+            // The number of bytes hashed.
+            uint64_t length = 0;
+
+            // Bytes that didn't fill a block yet.
+            uint8_t buffer[BlockSize];
+
+            // The result, once finalized.
+            digest_type result;
+
+            // True when the result is ready.
+            bool finalized = false;
+
+            static inline uint32_t rotate(uint32_t x, int n)
+            {
+                return (x << n) | (x >> (32 - n));
+            }
+
+            static inline uint32_t load(const uint8_t *p)
+            {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+                return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+#else
+                uint32_t x;
+                std::memcpy(&x, p, sizeof(x));
+                return x;
+#endif
+            }
+
+            /**
+             * Hashes whole blocks.
+             */
+            void transform(const uint8_t *p, size_t blocks)
+            {
+                auto a = state[0];
+                auto b = state[1];
+                auto c = state[2];
+                auto d = state[3];
+
+                for (; blocks > 0; --blocks, p += BlockSize)
+                {
+                    uint32_t x[16];
+
+                    for (auto i = 0; i < 16; ++i)
+                    {
+                        x[i] = load(p + i * 4);
+                    }
+
+                    auto aa = a, bb = b, cc = c, dd = d;
+
+#define CASC_MD5_STEP(f, a, b, c, d, x, s, t) a = rotate(a + (f) + (x) + (t), s) + (b)
+#define CASC_MD5_F(b, c, d) ((d) ^ ((b) & ((c) ^ (d))))
+#define CASC_MD5_G(b, c, d) ((c) ^ ((d) & ((b) ^ (c))))
+#define CASC_MD5_H(b, c, d) ((b) ^ (c) ^ (d))
+#define CASC_MD5_I(b, c, d) ((c) ^ ((b) | ~(d)))
+
+                    CASC_MD5_STEP(CASC_MD5_F(b, c, d), a, b, c, d, x[0], 7, 0xd76aa478);
+                    CASC_MD5_STEP(CASC_MD5_F(a, b, c), d, a, b, c, x[1], 12, 0xe8c7b756);
+                    CASC_MD5_STEP(CASC_MD5_F(d, a, b), c, d, a, b, x[2], 17, 0x242070db);
+                    CASC_MD5_STEP(CASC_MD5_F(c, d, a), b, c, d, a, x[3], 22, 0xc1bdceee);
+                    CASC_MD5_STEP(CASC_MD5_F(b, c, d), a, b, c, d, x[4], 7, 0xf57c0faf);
+                    CASC_MD5_STEP(CASC_MD5_F(a, b, c), d, a, b, c, x[5], 12, 0x4787c62a);
+                    CASC_MD5_STEP(CASC_MD5_F(d, a, b), c, d, a, b, x[6], 17, 0xa8304613);
+                    CASC_MD5_STEP(CASC_MD5_F(c, d, a), b, c, d, a, x[7], 22, 0xfd469501);
+                    CASC_MD5_STEP(CASC_MD5_F(b, c, d), a, b, c, d, x[8], 7, 0x698098d8);
+                    CASC_MD5_STEP(CASC_MD5_F(a, b, c), d, a, b, c, x[9], 12, 0x8b44f7af);
+                    CASC_MD5_STEP(CASC_MD5_F(d, a, b), c, d, a, b, x[10], 17, 0xffff5bb1);
+                    CASC_MD5_STEP(CASC_MD5_F(c, d, a), b, c, d, a, x[11], 22, 0x895cd7be);
+                    CASC_MD5_STEP(CASC_MD5_F(b, c, d), a, b, c, d, x[12], 7, 0x6b901122);
+                    CASC_MD5_STEP(CASC_MD5_F(a, b, c), d, a, b, c, x[13], 12, 0xfd987193);
+                    CASC_MD5_STEP(CASC_MD5_F(d, a, b), c, d, a, b, x[14], 17, 0xa679438e);
+                    CASC_MD5_STEP(CASC_MD5_F(c, d, a), b, c, d, a, x[15], 22, 0x49b40821);
+
+                    CASC_MD5_STEP(CASC_MD5_G(b, c, d), a, b, c, d, x[1], 5, 0xf61e2562);
+                    CASC_MD5_STEP(CASC_MD5_G(a, b, c), d, a, b, c, x[6], 9, 0xc040b340);
+                    CASC_MD5_STEP(CASC_MD5_G(d, a, b), c, d, a, b, x[11], 14, 0x265e5a51);
+                    CASC_MD5_STEP(CASC_MD5_G(c, d, a), b, c, d, a, x[0], 20, 0xe9b6c7aa);
+                    CASC_MD5_STEP(CASC_MD5_G(b, c, d), a, b, c, d, x[5], 5, 0xd62f105d);
+                    CASC_MD5_STEP(CASC_MD5_G(a, b, c), d, a, b, c, x[10], 9, 0x02441453);
+                    CASC_MD5_STEP(CASC_MD5_G(d, a, b), c, d, a, b, x[15], 14, 0xd8a1e681);
+                    CASC_MD5_STEP(CASC_MD5_G(c, d, a), b, c, d, a, x[4], 20, 0xe7d3fbc8);
+                    CASC_MD5_STEP(CASC_MD5_G(b, c, d), a, b, c, d, x[9], 5, 0x21e1cde6);
+                    CASC_MD5_STEP(CASC_MD5_G(a, b, c), d, a, b, c, x[14], 9, 0xc33707d6);
+                    CASC_MD5_STEP(CASC_MD5_G(d, a, b), c, d, a, b, x[3], 14, 0xf4d50d87);
+                    CASC_MD5_STEP(CASC_MD5_G(c, d, a), b, c, d, a, x[8], 20, 0x455a14ed);
+                    CASC_MD5_STEP(CASC_MD5_G(b, c, d), a, b, c, d, x[13], 5, 0xa9e3e905);
+                    CASC_MD5_STEP(CASC_MD5_G(a, b, c), d, a, b, c, x[2], 9, 0xfcefa3f8);
+                    CASC_MD5_STEP(CASC_MD5_G(d, a, b), c, d, a, b, x[7], 14, 0x676f02d9);
+                    CASC_MD5_STEP(CASC_MD5_G(c, d, a), b, c, d, a, x[12], 20, 0x8d2a4c8a);
+
+                    CASC_MD5_STEP(CASC_MD5_H(b, c, d), a, b, c, d, x[5], 4, 0xfffa3942);
+                    CASC_MD5_STEP(CASC_MD5_H(a, b, c), d, a, b, c, x[8], 11, 0x8771f681);
+                    CASC_MD5_STEP(CASC_MD5_H(d, a, b), c, d, a, b, x[11], 16, 0x6d9d6122);
+                    CASC_MD5_STEP(CASC_MD5_H(c, d, a), b, c, d, a, x[14], 23, 0xfde5380c);
+                    CASC_MD5_STEP(CASC_MD5_H(b, c, d), a, b, c, d, x[1], 4, 0xa4beea44);
+                    CASC_MD5_STEP(CASC_MD5_H(a, b, c), d, a, b, c, x[4], 11, 0x4bdecfa9);
+                    CASC_MD5_STEP(CASC_MD5_H(d, a, b), c, d, a, b, x[7], 16, 0xf6bb4b60);
+                    CASC_MD5_STEP(CASC_MD5_H(c, d, a), b, c, d, a, x[10], 23, 0xbebfbc70);
+                    CASC_MD5_STEP(CASC_MD5_H(b, c, d), a, b, c, d, x[13], 4, 0x289b7ec6);
+                    CASC_MD5_STEP(CASC_MD5_H(a, b, c), d, a, b, c, x[0], 11, 0xeaa127fa);
+                    CASC_MD5_STEP(CASC_MD5_H(d, a, b), c, d, a, b, x[3], 16, 0xd4ef3085);
+                    CASC_MD5_STEP(CASC_MD5_H(c, d, a), b, c, d, a, x[6], 23, 0x04881d05);
+                    CASC_MD5_STEP(CASC_MD5_H(b, c, d), a, b, c, d, x[9], 4, 0xd9d4d039);
+                    CASC_MD5_STEP(CASC_MD5_H(a, b, c), d, a, b, c, x[12], 11, 0xe6db99e5);
+                    CASC_MD5_STEP(CASC_MD5_H(d, a, b), c, d, a, b, x[15], 16, 0x1fa27cf8);
+                    CASC_MD5_STEP(CASC_MD5_H(c, d, a), b, c, d, a, x[2], 23, 0xc4ac5665);
+
+                    CASC_MD5_STEP(CASC_MD5_I(b, c, d), a, b, c, d, x[0], 6, 0xf4292244);
+                    CASC_MD5_STEP(CASC_MD5_I(a, b, c), d, a, b, c, x[7], 10, 0x432aff97);
+                    CASC_MD5_STEP(CASC_MD5_I(d, a, b), c, d, a, b, x[14], 15, 0xab9423a7);
+                    CASC_MD5_STEP(CASC_MD5_I(c, d, a), b, c, d, a, x[5], 21, 0xfc93a039);
+                    CASC_MD5_STEP(CASC_MD5_I(b, c, d), a, b, c, d, x[12], 6, 0x655b59c3);
+                    CASC_MD5_STEP(CASC_MD5_I(a, b, c), d, a, b, c, x[3], 10, 0x8f0ccc92);
+                    CASC_MD5_STEP(CASC_MD5_I(d, a, b), c, d, a, b, x[10], 15, 0xffeff47d);
+                    CASC_MD5_STEP(CASC_MD5_I(c, d, a), b, c, d, a, x[1], 21, 0x85845dd1);
+                    CASC_MD5_STEP(CASC_MD5_I(b, c, d), a, b, c, d, x[8], 6, 0x6fa87e4f);
+                    CASC_MD5_STEP(CASC_MD5_I(a, b, c), d, a, b, c, x[15], 10, 0xfe2ce6e0);
+                    CASC_MD5_STEP(CASC_MD5_I(d, a, b), c, d, a, b, x[6], 15, 0xa3014314);
+                    CASC_MD5_STEP(CASC_MD5_I(c, d, a), b, c, d, a, x[13], 21, 0x4e0811a1);
+                    CASC_MD5_STEP(CASC_MD5_I(b, c, d), a, b, c, d, x[4], 6, 0xf7537e82);
+                    CASC_MD5_STEP(CASC_MD5_I(a, b, c), d, a, b, c, x[11], 10, 0xbd3af235);
+                    CASC_MD5_STEP(CASC_MD5_I(d, a, b), c, d, a, b, x[2], 15, 0x2ad7d2bb);
+                    CASC_MD5_STEP(CASC_MD5_I(c, d, a), b, c, d, a, x[9], 21, 0xeb86d391);
+
+#undef CASC_MD5_STEP
+#undef CASC_MD5_F
+#undef CASC_MD5_G
+#undef CASC_MD5_H
+#undef CASC_MD5_I
+
+                    a += aa;
+                    b += bb;
+                    c += cc;
+                    d += dd;
+                }
+
+                state[0] = a;
+                state[1] = b;
+                state[2] = c;
+                state[3] = d;
+            }
+
+        public:
+            /**
+             * Constructor.
+             */
+            MD5()
+            {
+                state[0] = 0x67452301;
+                state[1] = 0xefcdab89;
+                state[2] = 0x98badcfe;
+                state[3] = 0x10325476;
+            }
+
+            /**
+             * Constructor. Hashes a string.
+             */
+            MD5(const std::string &text)
+                : MD5()
+            {
+                update(text.data(), text.size());
+            }
+
+            /**
+             * Constructor. Hashes a contiguous container.
+             */
+            template <typename Container>
+            MD5(const Container &input)
+                : MD5()
+            {
+                update(input.data(), input.size() * sizeof(typename Container::value_type));
+            }
+
+            /**
+             * Constructor. Hashes a contiguous range.
+             */
+            template <typename InputIt>
+            MD5(InputIt begin, InputIt end)
+                : MD5()
+            {
+                if (begin != end)
+                {
+                    update(&*begin, (end - begin) * sizeof(typename std::iterator_traits<InputIt>::value_type));
+                }
+            }
+
+            /**
+             * Adds bytes to the hash.
+             */
+            MD5 &update(const void *data, size_t size)
+            {
+                auto input = static_cast<const uint8_t*>(data);
+                auto used = static_cast<size_t>(length % BlockSize);
+
+                length += size;
+
+                if (used > 0)
+                {
+                    auto count = BlockSize - used < size ? BlockSize - used : size;
+                    std::memcpy(buffer + used, input, count);
+
+                    input += count;
+                    size -= count;
+
+                    if (used + count < BlockSize)
+                    {
+                        return *this;
+                    }
+
+                    transform(buffer, 1);
+                }
+
+                transform(input, size / BlockSize);
+
+                std::memcpy(buffer, input + size / BlockSize * BlockSize, size % BlockSize);
+
+                return *this;
+            }
+
+            /**
+             * Finishes the hash and returns the digest.
+             */
+            const digest_type &digest()
+            {
+                if (!finalized)
+                {
+                    auto bits = length * 8U;
+                    auto used = static_cast<size_t>(length % BlockSize);
+
+                    uint8_t tail[BlockSize * 2] = { };
+                    std::memcpy(tail, buffer, used);
+                    tail[used] = 0x80;
+
+                    auto blocks = used < 56 ? 1U : 2U;
+
+                    for (auto i = 0; i < 8; ++i)
+                    {
+                        tail[blocks * BlockSize - 8 + i] = uint8_t(bits >> (i * 8));
+                    }
+
+                    transform(tail, blocks);
+
+                    for (auto i = 0; i < 16; ++i)
+                    {
+                        result[i] = uint8_t(state[i / 4] >> ((i % 4) * 8));
+                    }
+
+                    finalized = true;
+                }
+
+                return result;
+            }
+
+            /**
+             * Finishes the hash and returns the digest as a lowercase hex string.
+             */
+            std::string hexdigest()
+            {
+                static const char digits[] = "0123456789abcdef";
+
+                std::string out(32, '0');
+                auto &bytes = digest();
+
+                for (auto i = 0; i < 16; ++i)
+                {
+                    out[i * 2] = digits[bytes[i] >> 4];
+                    out[i * 2 + 1] = digits[bytes[i] & 0xF];
+                }
+
+                return out;
+            }
+        };
+
         inline std::string md5(const std::string str)
         {
             return MD5(str).hexdigest();
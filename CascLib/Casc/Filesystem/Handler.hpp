@@ -27,7 +27,9 @@
 #include <fstream>
 
 #include "../Common.hpp"
-#include "../Hex.hpp"
+#include "../Key.hpp"
+
+#include "../IO/Snapshot.hpp"
 
 namespace Casc
 {
@@ -44,7 +46,12 @@ namespace Casc
             /**
              * Find the file content hash for the given filename.
              */
-            virtual Hex findHash(std::string path) const = 0;
+            virtual Key findHash(std::string path) const = 0;
+
+            /**
+             * Writes the lookup tables to a snapshot.
+             */
+            virtual void save(IO::SnapshotWriter &writer) const = 0;
 
         protected:
             /**
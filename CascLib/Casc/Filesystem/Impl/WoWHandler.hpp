@@ -19,19 +19,24 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <omp.h>
 #include <string>
 #include <memory>
-#include <map>
 #include <stdint.h>
-#include <array>
-#include <fstream>
+#include <vector>
 
 #include "../../Common.hpp"
-#include "../../Hex.hpp"
+#include "../../Key.hpp"
 #include "../Handler.hpp"
+#include "../Locales.hpp"
 
 #include "../../IO/Endian.hpp"
 #include "../../Crypto/Lookup3.hpp"
+#include "../../IO/SharedSpan.hpp"
+#include "../../IO/Snapshot.hpp"
 
 namespace Casc
 {
@@ -41,59 +46,304 @@ namespace Casc
         {
             /**
              * Maps filename to file content MD5 hash. Uses lookup3.
+             *
+             * The entries of the selected locales are kept in open-addressing tables over the 64-bit name hash,
+             * sharded by the top bits of the hash so the shards can be filled on separate threads.
              */
             class WoWHandler : public Handler
             {
-                std::map<std::pair<uint32_t, uint32_t>, uint32_t> integers;
-                std::map<std::pair<uint32_t, uint32_t>, Hex> checksums;
+                struct Entry
+                {
+                    // The lookup3 hash of the normalized path. Zero marks an empty slot.
+                    uint64_t name;
+
+                    // The content hash.
+                    Key hash;
+                };
+
+                struct Block
+                {
+                    // The first record (content hash and name hash) of the block.
+                    std::vector<char>::const_iterator records;
+
+                    // The number of records.
+                    size_t count;
+                };
+
+                // The number of bits of the name hash that pick the shard.
+                static const size_t ShardBits = 6U;
+
+                // The number of shards.
+                static const size_t ShardCount = size_t(1) << ShardBits;
+
+                // The records of a run of the blocks, by shard.
+                typedef std::array<std::vector<std::vector<char>::const_iterator>, ShardCount> Partition;
+
+                // The size of a record.
+                static const size_t RecordSize = 24U;
+
+                // The shards of the table. The size of each is a power of two.
+                std::array<IO::SharedSpan<Entry>, ShardCount> shards;
+
+                // The entry of a name that hashes to zero, which can't be told apart from an empty slot.
+                IO::SharedSpan<Entry> zero;
 
-            public:
                 /**
-                 * Find the file content hash for the given filename.
+                 * Hashes a path the way the root file does: upper case, with backslashes.
                  */
-                Hex findHash(std::string path) const override
+                static uint64_t hashName(std::string path)
                 {
-                    return checksums.at(Crypto::lookup3(path));
-                };
+                    for (auto &c : path)
+                    {
+                        c = c == '/' ? '\\' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+                    }
+
+                    auto hash = Crypto::lookup3(path);
+
+                    return static_cast<uint64_t>(hash.first) << 32 | hash.second;
+                }
 
-            public:
                 /**
-                 * Default constructor.
+                 * Gets the shard of a name.
                  */
-                WoWHandler(std::vector<char> &data)
+                static size_t findShard(uint64_t name)
                 {
+                    return static_cast<size_t>(name >> (64U - ShardBits));
+                }
+
+                /**
+                 * Gets the slot of a name in its shard, or the empty slot where it would go.
+                 */
+                template <typename Table>
+                static size_t slot(const Table &entries, uint64_t name)
+                {
+                    auto mask = entries.size() - 1;
+                    auto index = static_cast<size_t>(name) & mask;
+
+                    while (entries[index].name != 0 && entries[index].name != name)
+                    {
+                        index = (index + 1) & mask;
+                    }
+
+                    return index;
+                }
+
+                /**
+                 * Reads the name hash of a record.
+                 */
+                static uint64_t readName(std::vector<char>::const_iterator record)
+                {
+                    return IO::Endian::read<IO::EndianType::Little, uint64_t>(record + 16);
+                }
+
+                /**
+                 * Splits the root file into the blocks in the selected locales.
+                 */
+                static std::vector<Block> findBlocks(const std::vector<char> &data, uint32_t locales, uint32_t excludedFlags)
+                {
+                    std::vector<Block> blocks;
+
                     for (auto it = data.begin(), end = data.end(); it < end;)
                     {
+                        if (end - it < 12)
+                        {
+                            throw Exceptions::ParserException("Truncated root block.");
+                        }
+
                         auto count = IO::Endian::read<IO::EndianType::Little, uint32_t, true>(it);
                         auto flags = IO::Endian::read<IO::EndianType::Little, uint32_t, true>(it);
                         auto locale = IO::Endian::read<IO::EndianType::Little, uint32_t, true>(it);
 
-                        std::vector<std::pair<uint32_t, uint32_t>> hashes;
-                        std::vector<uint32_t> integers;
-                        std::vector<Hex> checksums;
+                        // The file data IDs come first, then the content hash and name hash of each file.
+                        if (static_cast<size_t>(end - it) / (RecordSize + 4U) < count)
+                        {
+                            throw Exceptions::ParserException("Truncated root block.");
+                        }
 
-                        std::map<uint32_t, uint32_t> counts;
+                        auto records = it + count * 4U;
+                        it += count * (RecordSize + 4U);
 
-                        for (auto i = 0U; i < count; ++i)
+                        if (count > 0 && (locale & locales) != 0 && (flags & excludedFlags) == 0)
                         {
-                            integers.push_back(IO::Endian::read<IO::EndianType::Little, uint32_t, true>(it));
+                            blocks.push_back({ records, count });
                         }
+                    }
+
+                    return blocks;
+                }
+
+                /**
+                 * Sorts a run of the records by shard, keeping them in file order.
+                 * The run is given by the index of its first and last record across all the blocks.
+                 */
+                static void partition(const std::vector<Block> &blocks, size_t begin, size_t end, Partition &partition)
+                {
+                    size_t first = 0;
+
+                    for (auto &block : blocks)
+                    {
+                        if (first + block.count > begin && first < end)
+                        {
+                            auto from = std::max(begin, first);
+                            auto to = std::min(end, first + block.count);
+                            auto record = block.records + (from - first) * RecordSize;
+
+                            for (auto i = from; i < to; ++i, record += RecordSize)
+                            {
+                                partition[findShard(readName(record))].push_back(record);
+                            }
+                        }
+
+                        first += block.count;
+                    }
+                }
+
+                /**
+                 * Fills a shard from the records of each run in turn, so the first variant of a name wins.
+                 */
+                void fill(size_t shard, const std::vector<Partition> &partitions)
+                {
+                    size_t count = 0;
+
+                    for (auto &partition : partitions)
+                    {
+                        count += partition[shard].size();
+                    }
+
+                    // Keeps the load factor at or below one half.
+                    size_t capacity = 16;
+
+                    while (capacity < count * 2)
+                    {
+                        capacity *= 2;
+                    }
+
+                    std::vector<Entry> entries(capacity, Entry{ 0, Key() });
+                    std::vector<Entry> zeros;
 
-                        for (auto i = 0U; i < count; ++i)
+                    for (auto &partition : partitions)
+                    {
+                        for (auto record : partition[shard])
                         {
-                            checksums.emplace_back(it, it + 16);
-                            it += 16;
+                            auto name = readName(record);
+
+                            if (name == 0)
+                            {
+                                if (zeros.empty())
+                                {
+                                    zeros.push_back({ name, Key(record, record + 16) });
+                                }
+
+                                continue;
+                            }
+
+                            auto &entry = entries[slot(entries, name)];
 
-                            hashes.push_back(std::make_pair(
-                                IO::Endian::read<IO::EndianType::Little, uint32_t, true>(it),
-                                IO::Endian::read<IO::EndianType::Little, uint32_t, true>(it)));
+                            if (entry.name == 0)
+                            {
+                                entry = { name, Key(record, record + 16) };
+                            }
                         }
+                    }
+
+                    shards[shard] = IO::SharedSpan<Entry>(std::move(entries));
+
+                    // Names that hash to zero land in the first shard.
+                    if (shard == 0)
+                    {
+                        zero = IO::SharedSpan<Entry>(std::move(zeros));
+                    }
+                }
 
-                        for (auto i = 0U; i < count; i++)
+            public:
+                /**
+                 * Find the file content hash for the given filename.
+                 */
+                Key findHash(std::string path) const override
+                {
+                    auto name = hashName(path);
+
+                    if (name == 0)
+                    {
+                        if (zero.empty())
                         {
-                            this->integers[hashes[i]] = integers[i];
-                            this->checksums[hashes[i]] = checksums[i];
+                            throw Exceptions::FilenameDoesNotExistException(path);
                         }
+
+                        return zero[0].hash;
+                    }
+
+                    auto &entries = shards[findShard(name)];
+                    auto &entry = entries[slot(entries, name)];
+
+                    if (entry.name == 0)
+                    {
+                        throw Exceptions::FilenameDoesNotExistException(path);
+                    }
+
+                    return entry.hash;
+                };
+
+            public:
+                /**
+                 * Constructor. Keeps the blocks in any of the locales that have none of the excluded content flags.
+                 */
+                WoWHandler(const std::vector<char> &data, uint32_t locales = AllLocales, uint32_t excludedFlags = 0)
+                {
+                    auto blocks = findBlocks(data, locales, excludedFlags);
+                    size_t total = 0;
+
+                    for (auto &block : blocks)
+                    {
+                        total += block.count;
+                    }
+
+                    // The records are read once, split into equal runs that are sorted by shard on separate threads.
+                    // Each shard is then filled from the runs in file order.
+                    std::vector<Partition> partitions(static_cast<size_t>(omp_get_max_threads()));
+
+                    #pragma omp parallel for
+                    for (auto i = 0; i < int(partitions.size()); ++i)
+                    {
+                        partition(blocks, total * i / partitions.size(), total * (i + 1) / partitions.size(), partitions[i]);
+                    }
+
+                    #pragma omp parallel for schedule(dynamic)
+                    for (auto i = 0; i < int(ShardCount); ++i)
+                    {
+                        fill(size_t(i), partitions);
+                    }
+                }
+
+                /**
+                 * Constructor. Reads the tables from a snapshot.
+                 */
+                WoWHandler(IO::Snapshot &snapshot)
+                {
+                    zero = snapshot.next<Entry>();
+
+                    for (auto &shard : shards)
+                    {
+                        shard = snapshot.next<Entry>();
+
+                        // Lookups wrap around with a mask, so the size has to be a power of two.
+                        if (shard.empty() || (shard.size() & (shard.size() - 1)) != 0)
+                        {
+                            throw Exceptions::ParserException("The snapshot doesn't match the tables read from it.");
+                        }
+                    }
+                }
+
+                /**
+                 * Writes the lookup tables to a snapshot.
+                 */
+                void save(IO::SnapshotWriter &writer) const override
+                {
+                    writer.add(zero.span());
+
+                    for (auto &shard : shards)
+                    {
+                        writer.add(shard.span());
                     }
                 }
 
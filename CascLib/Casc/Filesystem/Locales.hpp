@@ -0,0 +1,68 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace Casc
+{
+    namespace Filesystem
+    {
+        /**
+        * The locales of a block of root entries. Blocks can be in several locales, so these are combined as a mask.
+        */
+        enum Locale : uint32_t
+        {
+            enUS = 0x2,
+            koKR = 0x4,
+            frFR = 0x10,
+            deDE = 0x20,
+            zhCN = 0x40,
+            esES = 0x80,
+            zhTW = 0x100,
+            enGB = 0x200,
+            enCN = 0x400,
+            enTW = 0x800,
+            esMX = 0x1000,
+            ruRU = 0x2000,
+            ptBR = 0x4000,
+            itIT = 0x8000,
+            ptPT = 0x10000,
+            AllLocales = 0xFFFFFFFF
+        };
+
+        /**
+        * The content flags of a block of root entries, combined as a mask.
+        */
+        enum ContentFlags : uint32_t
+        {
+            LoadOnWindows = 0x8,
+            LoadOnMacOS = 0x10,
+            LowViolence = 0x80,
+            DoNotLoad = 0x100,
+            UpdatePlugin = 0x800,
+            Encrypted = 0x8000000,
+            NoNameHash = 0x10000000,
+            UncommonResolution = 0x20000000,
+            Bundle = 0x40000000,
+            NoCompression = 0x80000000
+        };
+    }
+}
\ No newline at end of file
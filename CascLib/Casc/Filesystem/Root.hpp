@@ -21,6 +21,7 @@
 
 #include "../Common.hpp"
 #include "Handler.hpp"
+#include "Locales.hpp"
 #include "../Parsers/Binary/Encoding.hpp"
 #include "../Parsers/Binary/Index.hpp"
 #include "../IO/StreamAllocator.hpp"
@@ -35,25 +36,31 @@ namespace Casc
             std::unique_ptr<Handler> handler = nullptr;
 
         public:
-            Root(ProgramCode game, Hex hash, std::shared_ptr<Parsers::Binary::Encoding> encoding = nullptr,
+            Root(ProgramCode game, Key hash, std::shared_ptr<Parsers::Binary::Encoding> encoding = nullptr,
                  std::shared_ptr<Parsers::Binary::Index> index = nullptr,
-                 std::shared_ptr<IO::StreamAllocator> allocator = nullptr)
+                 std::shared_ptr<IO::StreamAllocator> allocator = nullptr,
+                 uint32_t locales = AllLocales, uint32_t excludedFlags = 0)
             {
-                auto fi = encoding->findFileInfo(hash);
-                auto enc = encoding->findEncodedFileInfo(fi.keys[0]);
-                auto ref = index->find(fi.keys[0].begin(), fi.keys[0].begin() + 9);
+                auto fi = encoding->viewFileInfo(hash);
+                auto ref = index->find(IndexKey(fi.key(0)));
                 
-                auto stream = allocator->data(ref);
+                auto stream = allocator->data(ref, IO::AccessPattern::Sequential);
 
-                std::vector<char> buf(fi.size);
+                // Large reads are decoded straight into the destination, so this is the only copy of the file.
+                std::vector<char> buf(fi.size());
                 stream->read(buf.data(), buf.size());
 
+                if (size_t(stream->gcount()) != buf.size())
+                {
+                    throw Exceptions::IOException("Couldn't read the root file.");
+                }
+
                 switch (game)
                 {
                 case ProgramCode::wow:
                 case ProgramCode::wowt:
                 case ProgramCode::wow_beta:
-                    handler = std::make_unique<Impl::WoWHandler>(buf);
+                    handler = std::make_unique<Impl::WoWHandler>(buf, locales, excludedFlags);
                     break;
 
                 default:
@@ -61,10 +68,36 @@ namespace Casc
                 }
             }
 
-            Hex find(std::string path) const
+            /**
+             * Constructor. Reads the tables from a snapshot.
+             */
+            Root(ProgramCode game, IO::Snapshot &snapshot)
+            {
+                switch (game)
+                {
+                case ProgramCode::wow:
+                case ProgramCode::wowt:
+                case ProgramCode::wow_beta:
+                    handler = std::make_unique<Impl::WoWHandler>(snapshot);
+                    break;
+
+                default:
+                    throw Exceptions::FilesystemException("Unsupported root file format");
+                }
+            }
+
+            Key find(std::string path) const
             {
                 return handler->findHash(path);
             }
+
+            /**
+             * Writes the tables to a snapshot.
+             */
+            void save(IO::SnapshotWriter &writer) const
+            {
+                handler->save(writer);
+            }
         };
     }
 }
\ No newline at end of file
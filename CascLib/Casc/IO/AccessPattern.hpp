@@ -0,0 +1,45 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+namespace Casc
+{
+    namespace IO
+    {
+        /**
+        * How a range of a file will be read. Passed on to the OS as a hint.
+        */
+        enum class AccessPattern
+        {
+            // No hint.
+            Normal,
+
+            // Read front to back soon, e.g. by a loader or a scan. The OS reads ahead.
+            Sequential,
+
+            // Point reads. The OS doesn't read ahead of mapped ranges; read through a descriptor, it's the same as Normal.
+            Random,
+
+            // Read front to back once, e.g. by an export. The pages are dropped when the reader is done,
+            // so they don't evict the working set of other processes.
+            Once
+        };
+    }
+}
\ No newline at end of file
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <fstream>
 #include <iomanip>
@@ -30,12 +31,19 @@
 
 #include "../Exceptions.hpp"
 
-#include "../md5.hpp"
 #include "../zlib.hpp"
 
+#include "../Crypto/Lookup3.hpp"
+#include "../Crypto/MD5.hpp"
+
+#include "AccessPattern.hpp"
+#include "ChunkCache.hpp"
 #include "Handler.hpp"
 #include "Endian.hpp"
-#include "../Hex.hpp"
+#include "File.hpp"
+#include "MappedFile.hpp"
+#include "VerificationMode.hpp"
+#include "../Key.hpp"
 
 namespace Casc
 {
@@ -49,10 +57,15 @@ namespace Casc
         private:
             static const uint32_t Signature = 0x45544C42;
             static const size_t DataHeaderSize = 30U;
-            static const size_t BufferSize = 4096U;
+            static const size_t MinBufferSize = 4096U;
+            static const size_t MaxBufferSize = 1U << 20;
+            static const size_t PrefetchSize = 0x10000U;
+
+            // The data file.
+            std::shared_ptr<File> file;
 
-            // The underlying stream buffer.
-            std::shared_ptr<std::fstream> fbuf;
+            // The mapped data file. Used instead of the file when set.
+            std::shared_ptr<const MappedFile> mapping;
 
             // True when the file is properly initialized.
             // The file is properly initialized once all the headers have been read.
@@ -64,86 +77,383 @@ namespace Casc
             // The offset of the file.
             size_t offset;
 
+            // The size of the file in the data file, including the data header, or zero when unknown.
+            size_t extent = 0;
+
+            // The start of the file, read in one go when it's opened. Chunks inside it are decoded from memory.
+            std::shared_ptr<std::vector<char>> head;
+
+            // The position of the first chunk in the data file.
+            size_t chunksOffset;
+
+            // The chunks, in logical order.
+            std::vector<Chunk> chunks;
+
             // The offset of the buffer.
             size_t current;
 
             // The buffer.
             std::vector<char> buf;
 
-            // Chunk handlers.
+            // The size of a refill, or zero to match the size of the chunk being read.
+            size_t bufferSize = 0;
+
+            // Chunk handlers. They're created when a chunk is first accessed.
             std::vector<std::shared_ptr<Handler>> handlers;
 
+            // The cache of decoded chunks shared with other buffers, if any.
+            std::shared_ptr<ChunkCache> cache;
+
+            // The encoding key of the file, from the data header.
+            std::array<uint8_t, 16> key;
+
+            // When the checksums are checked.
+            VerificationMode verification = VerificationMode::None;
+
+            // How the file is read, passed on to the OS.
+            AccessPattern access = AccessPattern::Normal;
+
+            // How far each chunk has gone through the cache.
+            enum class CacheState : uint8_t
+            {
+                Unchecked,
+                Checked,
+                Published
+            };
+
+            // The cache state of each chunk.
+            std::vector<CacheState> cacheStates;
+
+            /**
+             * Serves a chunk from the cache if it's there.
+             */
+            void lookup(size_t index)
+            {
+                if (cache == nullptr || cacheStates[index] != CacheState::Unchecked)
+                {
+                    return;
+                }
+
+                cacheStates[index] = CacheState::Checked;
+
+                auto mode = handlers[index] != nullptr ? handlers[index]->mode() : chunkMode(index);
+
+                // Uncompressed chunks are read straight from the data file.
+                if (mode == EncodingMode::None)
+                {
+                    cacheStates[index] = CacheState::Published;
+                    return;
+                }
+
+                auto data = cache->find({ key, index });
+
+                if (data == nullptr)
+                {
+                    return;
+                }
+
+                // The cached chunk was checked when it was decoded, so the handler neither reads nor checks it again.
+                auto &handler = handlers[index];
+
+                if (handler == nullptr)
+                {
+                    auto &chunk = chunks[index];
+                    handler = createHandler(mode, chunk, createLazySource(chunksOffset + chunk.offset, chunksOffset + chunk.offset + chunk.size));
+
+                    if (!handler->share(data))
+                    {
+                        handler = nullptr;
+                        return;
+                    }
+
+                    cacheStates[index] = CacheState::Published;
+                }
+                else if (handler->share(data))
+                {
+                    cacheStates[index] = CacheState::Published;
+                }
+            }
+
+            /**
+             * Adds a chunk to the cache once it has been fully decoded.
+             */
+            void publish(size_t index)
+            {
+                if (cache == nullptr || cacheStates[index] == CacheState::Published)
+                {
+                    return;
+                }
+
+                auto data = handler(index)->shared();
+
+                if (data != nullptr)
+                {
+                    cache->insert({ key, index }, data);
+                    cacheStates[index] = CacheState::Published;
+                }
+            }
+
+            /**
+             * Throws if a checksum doesn't match.
+             */
+            static void verify(const std::array<uint8_t, 16> &expected, const std::array<uint8_t, 16> &actual)
+            {
+                if (expected != actual)
+                {
+                    throw Exceptions::InvalidHashException(
+                        Crypto::lookup3(expected, 0), Crypto::lookup3(actual, 0), "");
+                }
+            }
+
+            /**
+             * Drops the file from the page cache if it was only going to be read once.
+             */
+            void release()
+            {
+                if (access != AccessPattern::Once || extent == 0)
+                {
+                    return;
+                }
+
+                if (mapping != nullptr)
+                {
+                    mapping->release(offset, extent);
+                }
+                else if (file != nullptr)
+                {
+                    file->release(offset, extent);
+                }
+            }
+
+            /**
+             * Gets bytes from the start of the file, reading them if needed.
+             */
+            Span<const char> fetch(size_t position, size_t count)
+            {
+                if (mapping != nullptr)
+                {
+                    auto view = mapping->view(position, count);
+
+                    if (view.size() != count)
+                    {
+                        throw Exceptions::IOException("Read past the end of the data file.");
+                    }
+
+                    return view;
+                }
+
+                auto end = position + count - this->offset;
+
+                if (head->size() < end)
+                {
+                    auto size = head->size();
+                    head->resize(end);
+
+                    if (file->read(this->offset + size, { head->data() + size, end - size }) != end - size)
+                    {
+                        throw Exceptions::IOException("Couldn't read from the data file.");
+                    }
+                }
+
+                return Span<const char>(head->data(), head->size()).subspan(position - this->offset, count);
+            }
+
+            /**
+             * Creates a data source for a range of the data file.
+             */
+            std::shared_ptr<DataSource> createSource(size_t begin, size_t end)
+            {
+                if (mapping != nullptr)
+                {
+                    return std::make_shared<Impl::MemoryMappedSource>(mapping, std::make_pair(begin, end));
+                }
+
+                if (end - this->offset <= head->size())
+                {
+                    return std::make_shared<Impl::MemoryMappedSource>(
+                        head, std::make_pair(begin - this->offset, end - this->offset));
+                }
+
+                // Read chunks of a reasonable size whole, so the handler doesn't go back to the file.
+                // Chunks that are checked are always read whole, so they're hashed from memory and not read twice.
+                if (end - begin <= MaxBufferSize || verification != VerificationMode::None)
+                {
+                    std::vector<char> bytes(end - begin);
+
+                    if (file->read(begin, { bytes.data(), bytes.size() }) != bytes.size())
+                    {
+                        throw Exceptions::IOException("Couldn't read from the data file.");
+                    }
+
+                    return std::make_shared<Impl::MemoryMappedSource>(std::move(bytes));
+                }
+
+                return std::make_shared<Impl::FileSource>(file, std::make_pair(begin, end));
+            }
+
+            /**
+             * Creates a data source for a range of the data file that doesn't read anything until it's used.
+             */
+            std::shared_ptr<DataSource> createLazySource(size_t begin, size_t end)
+            {
+                if (mapping != nullptr)
+                {
+                    return std::make_shared<Impl::MemoryMappedSource>(mapping, std::make_pair(begin, end));
+                }
+
+                return std::make_shared<Impl::FileSource>(file, std::make_pair(begin, end));
+            }
+
+            /**
+             * Reads the encoding mode of a chunk, without reading the rest of it.
+             */
+            EncodingMode chunkMode(size_t index)
+            {
+                auto position = chunksOffset + chunks[index].offset;
+                char mode;
+
+                if (mapping != nullptr || position < this->offset + head->size())
+                {
+                    mode = fetch(position, 1)[0];
+                }
+                else if (file->read(position, { &mode, 1 }) != 1)
+                {
+                    throw Exceptions::IOException("Chunk is empty.");
+                }
+
+                return EncodingMode(uint8_t(mode));
+            }
+
+            /**
+             * Gets the handler of a chunk, creating it on first access.
+             */
+            const std::shared_ptr<Handler> &handler(size_t index)
+            {
+                auto &handler = handlers[index];
+
+                if (handler == nullptr)
+                {
+                    auto &chunk = chunks[index];
+                    auto source = createSource(chunksOffset + chunk.offset, chunksOffset + chunk.offset + chunk.size);
+
+                    char mode;
+
+                    if (source->read(0, { &mode, 1 }) != 1)
+                    {
+                        throw Exceptions::IOException("Chunk is empty.");
+                    }
+
+                    handler = createHandler(EncodingMode(uint8_t(mode)), chunk, source);
+
+                    // The bytes were just read, so they're hashed before anything is decoded from them.
+                    if (verification != VerificationMode::None && !handler->validate())
+                    {
+                        auto actual = handler->hash();
+                        handler = nullptr;
+
+                        throw Exceptions::InvalidHashException(
+                            Crypto::lookup3(chunk.checksum, 0), Crypto::lookup3(actual, 0), "");
+                    }
+                }
+
+                return handler;
+            }
+
             /**
-             * Read the header for the current file, create handlers
-             * and confirm checksums.
+             * Read the header for the current file and the block table.
+             * Handlers are created when their chunks are first accessed.
              */
             void init()
             {
+                setg(nullptr, nullptr, nullptr);
+
                 handlers.clear();
+                chunks.clear();
+                head = mapping == nullptr ? std::make_shared<std::vector<char>>() : nullptr;
                 length = 0;
                 current = 0;
 
-                std::array<char, DataHeaderSize> dataHeader;
-                fbuf->read(dataHeader.data(), DataHeaderSize);
-                this->offset += 30;
+                // Get the headers, the block table and usually the first chunks with a single read.
+                auto position = this->offset;
+                fetch(position, extent > 0 ? std::min(extent, size_t(PrefetchSize)) : DataHeaderSize + 8);
+
+                auto dataHeader = fetch(position, DataHeaderSize);
+                position += DataHeaderSize;
 
-                std::array<uint8_t, 16> blockTableChecksum;
-                std::copy(dataHeader.data(), dataHeader.data() + 16, blockTableChecksum.begin());
-                std::reverse(blockTableChecksum.begin(), blockTableChecksum.end());
-                auto size = Endian::read<EndianType::Little, uint32_t>(dataHeader.data() + 16);
+                // The data header starts with the encoding key, reversed.
+                std::array<uint8_t, 16> checksum;
+                std::copy(dataHeader.begin(), dataHeader.begin() + 16, checksum.begin());
+                std::reverse(checksum.begin(), checksum.end());
+                std::copy(dataHeader.begin(), dataHeader.begin() + 16, key.begin());
+                auto size = Endian::read<EndianType::Little, uint32_t>(dataHeader.begin() + 16);
 
-                MD5 blockTableVerficiation;
+                // The encoding key is the MD5 of the header and the block table, or of the whole file without one.
+                Crypto::MD5 hash;
 
-                std::array<char, 8> header;
-                fbuf->read(header.data(), header.size());
-                this->offset += 8;
+                auto header = fetch(position, 8);
+                position += header.size();
 
-                blockTableVerficiation.update(header.data(), header.size());
+                hash.update(header.data(), header.size());
 
                 auto blockTableSize = getBlockTableSize(header.begin());
-                this->offset += blockTableSize;
 
                 if (blockTableSize > 0)
                 {
-                    std::vector<char> blockTable(blockTableSize);
-                    fbuf->read(blockTable.data(), blockTableSize);
+                    auto blockTable = fetch(position, blockTableSize);
+                    position += blockTableSize;
 
-                    blockTableVerficiation.update(blockTable);
-                    blockTableVerficiation.finalize();
+                    if (verification != VerificationMode::None)
+                    {
+                        hash.update(blockTable.data(), blockTable.size());
+                        verify(checksum, hash.digest());
+                    }
 
-                    // TODO: Compare checksums
+                    chunks = parseBlockTable(blockTable.begin(), blockTable.end());
+                    chunksOffset = position;
 
-                    auto chunks = parseBlockTable(blockTable.begin(), blockTable.end());
+                    handlers.resize(chunks.size());
+                    length = chunks.empty() ? 0 : chunks.back().end;
 
-                    for (auto &chunk : chunks)
+                    if (verification == VerificationMode::Eager)
                     {
-                        fbuf->seekg(this->offset + chunk.offset);
-                        EncodingMode mode = (EncodingMode)fbuf->get();
-
-                        auto source = std::make_shared<Impl::StreamSource>(fbuf, std::make_pair(this->offset + chunk.offset, this->offset + chunk.offset + chunk.size));
-
-                        handlers.push_back(createHandler(mode, chunk, source));
+                        for (size_t i = 0; i < chunks.size(); ++i)
+                        {
+                            handler(i);
+                        }
                     }
                 }
                 else
                 {
-                    auto offset = fbuf->tellg();
+                    // The size in the data header includes the headers.
+                    if (this->offset + size <= position)
+                    {
+                        throw Exceptions::IOException("Invalid file size.");
+                    }
 
-                    if (offset < 0)
+                    auto source = createSource(position, this->offset + size);
+
+                    if (verification != VerificationMode::None)
                     {
-                        throw Exceptions::IOException("Negative stream offset is invalid.");
+                        auto data = source->view(0, SIZE_MAX);
+                        hash.update(data.data(), data.size());
+                        verify(checksum, hash.digest());
                     }
 
-                    EncodingMode mode = (EncodingMode)fbuf->get();
-                    auto source = std::make_shared<Impl::StreamSource>(fbuf, std::make_pair(size_t(offset), size_t(offset) + size));
+                    char mode;
 
-                    handlers.push_back(createHandler(mode, source));
-                }
+                    if (source->read(0, { &mode, 1 }) != 1)
+                    {
+                        throw Exceptions::IOException("Chunk is empty.");
+                    }
 
-                for (auto &handler : handlers)
-                {
-                    length += handler->logicalSize();
+                    handlers.push_back(createHandler(EncodingMode(uint8_t(mode)), source));
+                    chunks.push_back(handlers.back()->chunk);
+                    chunksOffset = position;
+
+                    length = handlers.back()->logicalSize();
                 }
+
+                cacheStates.assign(handlers.size(), CacheState::Unchecked);
             }
 
             /**
@@ -192,7 +502,7 @@ namespace Casc
 
                 auto newOffset = pos() + offset;
 
-                if (newOffset >= current && newOffset < current + 4096)
+                if (newOffset >= current && newOffset < current + size_t(egptr() - eback()))
                 {
                     return seekbuf(offset, dir);
                 }
@@ -215,7 +525,7 @@ namespace Casc
                     offset = length - offset;
                 }
 
-                if (offset >= current && offset < current + 4096)
+                if (offset >= current && offset < current + size_t(egptr() - eback()))
                 {
                     return seekbuf(offset - current, std::ios_base::beg);
                 }
@@ -238,32 +548,89 @@ namespace Casc
                 }
             }
 
+            /**
+             * Finds the index of the chunk containing an offset.
+             */
+            size_t find(size_t offset) const
+            {
+                // The chunks are sorted, so the first chunk that ends after the offset is the one containing it.
+                auto first = std::upper_bound(chunks.begin(), chunks.end(), offset,
+                    [](size_t offset, const Chunk &chunk) { return offset < chunk.end; });
+
+                return size_t(first - chunks.begin());
+            }
+
+            /**
+             * Decodes data from an offset into the output, chunk by chunk.
+             * Returns the number of bytes decoded.
+             */
+            size_t decode(size_t offset, Span<char> out)
+            {
+                size_t count = 0;
+
+                for (auto i = find(offset); i < chunks.size() && count < out.size(); ++i)
+                {
+                    auto &chunk = chunks[i];
+
+                    if (chunk.end == chunk.begin)
+                    {
+                        continue;
+                    }
+
+                    auto begin = chunk.begin < offset ? offset - chunk.begin : 0;
+
+                    lookup(i);
+
+                    count += handler(i)->decode(begin, out.subspan(count));
+
+                    publish(i);
+                }
+
+                return count;
+            }
+
             /**
              * Read the decompressed data from the current chunk into the buffer.
              */
             pos_type buffer(off_type offset)
             {
-                auto count = 0U;
+                auto index = find(size_t(offset));
 
-                for (auto &handler : handlers)
+                // Point the get area straight at the data when the handler can hand out a view.
+                if (index < chunks.size() && chunks[index].begin <= size_t(offset))
                 {
-                    if (count < BufferSize && ((handler->chunk.begin < offset
-                        && handler->chunk.end > offset) || handler->chunk.begin >= offset))
+                    lookup(index);
+
+                    auto view = handler(index)->view(size_t(offset) - chunks[index].begin, SIZE_MAX);
+
+                    publish(index);
+
+                    if (!view.empty())
                     {
-                        auto begin = (handler->chunk.begin < offset
-                            && handler->chunk.end > offset) ? size_t(offset - handler->chunk.begin) : 0;
-                        auto decoded = handler->decode(begin, BufferSize - count);
+                        auto begin = const_cast<char*>(view.data());
+                        setg(begin, begin, begin + view.size());
+
+                        current = size_t(offset);
 
-                        std::memcpy(buf.data() + count, decoded.data(), decoded.size());
-                        count += decoded.size();
+                        return pos();
                     }
                 }
 
-                if (count < BufferSize)
+                auto size = bufferSize;
+
+                if (size == 0)
+                {
+                    size = index < chunks.size() ? chunks[index].end - chunks[index].begin : 0;
+                    size = std::min(std::max(size, size_t(MinBufferSize)), size_t(MaxBufferSize));
+                }
+
+                if (buf.size() < size)
                 {
-                    std::memset(buf.data() + count, 0, BufferSize - count);
+                    buf.resize(size);
                 }
 
+                auto count = decode(size_t(offset), { buf.data(), size });
+
                 setg(buf.data(), buf.data(), buf.data() + count);
 
                 current = size_t(offset);
@@ -298,48 +665,70 @@ namespace Casc
                 }
 
                 buffer(pos());
-                return traits_type::to_int_type(buf[0]);
+
+                if (gptr() == egptr())
+                {
+                    return traits_type::eof();
+                }
+
+                return traits_type::to_int_type(*gptr());
             }
 
             int_type uflow() override
             {
-                if (pos() == pos_type(length))
+                auto ch = underflow();
+
+                if (ch != traits_type::eof())
                 {
-                    setg(nullptr, nullptr, nullptr);
-                    return traits_type::eof();
+                    seekbuf(1);
                 }
 
-                buffer(pos());
-                seekbuf(1);
-
-                return traits_type::to_int_type(buf[1]);
+                return ch;
             }
 
             std::streamsize xsgetn(char_type* s, std::streamsize count) override
             {
-                std::streamsize copied = 0;
+                // Take what's left in the get area first.
+                auto copied = std::min(showmanyc(), count);
 
-                if (count <= showmanyc())
+                if (copied > 0)
                 {
-                    std::memcpy(s, gptr(), static_cast<size_t>(count));
-                    seekbuf(count);
-                    copied = count;
+                    std::memcpy(s, gptr(), static_cast<size_t>(copied));
+                    seekbuf(copied);
                 }
-                else
+
+                while (copied < count)
                 {
-                    do
+                    auto remaining = static_cast<size_t>(count - copied);
+
+                    if (remaining >= MinBufferSize)
+                    {
+                        // Large reads are decoded straight into the caller's memory.
+                        auto offset = size_t(pos());
+                        auto numRead = decode(offset, { s + copied, remaining });
+
+                        if (numRead == 0)
+                        {
+                            break;
+                        }
+
+                        copied += numRead;
+
+                        setg(nullptr, nullptr, nullptr);
+                        current = offset + numRead;
+                    }
+                    else
                     {
-                        if (showmanyc() == 0)
+                        if (underflow() == traits_type::eof())
                         {
-                            buffer(pos());
+                            break;
                         }
 
-                        auto numRead = std::min<size_t>(
-                            static_cast<size_t>(showmanyc()), static_cast<size_t>(count - copied));
+                        auto numRead = std::min(static_cast<size_t>(showmanyc()), remaining);
                         std::memcpy(s + copied, gptr(), numRead);
                         copied += numRead;
                         seekbuf(numRead);
-                    } while (copied < count && underflow() != traits_type::eof());
+                    }
                 }
 
                 return copied;
@@ -355,7 +744,7 @@ namespace Casc
              * Default constructor.
              */
             Buffer()
-                : buf(BufferSize), fbuf(new std::fstream())
+                : buf(MinBufferSize)
             {
             }
 
@@ -372,23 +761,38 @@ namespace Casc
             /**
             * Destructor.
             */
-            virtual ~Buffer() = default;
+            virtual ~Buffer()
+            {
+                release();
+            }
 
             /**
              * Reads a file from a new offset within the open data file.
              * Throws if is_open() is false.
              */
-            void open(size_t offset)
+            void open(size_t offset, size_t size = 0)
             {
                 this->isInitialized = false;
 
-                if (!fbuf->is_open())
+                if (!is_open())
                 {
                     throw Exceptions::IOException("Buffer is not open.");
                 }
 
                 this->offset = offset;
-                fbuf->seekg(offset);
+                this->extent = size;
+
+                if (extent > 0)
+                {
+                    if (mapping != nullptr)
+                    {
+                        mapping->advise(offset, extent, access);
+                    }
+                    else
+                    {
+                        file->advise(offset, extent, access);
+                    }
+                }
 
                 this->init();
 
@@ -400,14 +804,67 @@ namespace Casc
              */
             void open(const std::string filename, size_t offset)
             {
-                fbuf->open(filename, std::ios_base::in | std::ios_base::binary);
-                
-                if (fbuf->fail())
-                {
-                    throw Exceptions::IOException("Couldn't open buffer.");
-                }
+                open(std::make_shared<File>(filename), offset);
+            }
+
+            /**
+             * Reads a file from an offset within an open data file.
+             * The size of the file, if known, lets the headers be read in one go.
+             */
+            void open(std::shared_ptr<File> file, size_t offset, size_t size = 0)
+            {
+                release();
+
+                this->mapping = nullptr;
+                this->file = file;
+
+                open(offset, size);
+            }
+
+            /**
+             * Reads a file from an offset within a mapped data file.
+             */
+            void open(std::shared_ptr<const MappedFile> file, size_t offset, size_t size = 0)
+            {
+                release();
+
+                this->file = nullptr;
+                this->mapping = file;
 
-                open(offset);
+                open(offset, size);
+            }
+
+            /**
+             * Sets the size of a refill when data has to be copied into the buffer.
+             * Zero matches the size of the chunk being read.
+             */
+            void setBufferSize(size_t size)
+            {
+                bufferSize = size;
+            }
+
+            /**
+             * Sets when the checksums of the files opened after this are checked.
+             */
+            void setVerification(VerificationMode mode)
+            {
+                verification = mode;
+            }
+
+            /**
+             * Sets how the files opened after this are read.
+             */
+            void setAccessPattern(AccessPattern pattern)
+            {
+                access = pattern;
+            }
+
+            /**
+             * Shares decoded chunks with other buffers through a cache.
+             */
+            void setCache(std::shared_ptr<ChunkCache> cache)
+            {
+                this->cache = cache;
             }
 
             /**
@@ -415,7 +872,7 @@ namespace Casc
              */
             bool is_open() const
             {
-                return fbuf->is_open();
+                return mapping != nullptr || file != nullptr;
             }
 
             /**
@@ -423,13 +880,12 @@ namespace Casc
              */
             void close()
             {
-                setg(nullptr, nullptr, nullptr);
+                release();
 
-                if (fbuf->is_open())
-                {
-                    fbuf->close();
-                }
+                setg(nullptr, nullptr, nullptr);
 
+                file = nullptr;
+                mapping = nullptr;
                 isInitialized = false;
             }
 
@@ -473,15 +929,13 @@ namespace Casc
                 {
                     auto physicalSize = Endian::read<EndianType::Big, uint32_t>(it);
                     auto logicalSize = Endian::read<EndianType::Big, uint32_t>(it + 4);
-                    std::array<char, 16> checksumBytes;
-                    std::copy(it + 8, it + 24, checksumBytes.data());
 
                     chunks.push_back({
                         chunks.size() > 0 ? chunks.rbegin()->end : 0,
                         chunks.size() > 0 ? chunks.rbegin()->end + logicalSize : logicalSize,
                         chunks.size() > 0 ? chunks.rbegin()->offset + chunks.rbegin()->size : 0,
                         physicalSize,
-                        checksumBytes
+                        Key(it + 8, it + 24)
                     });
                 }
 
@@ -19,7 +19,7 @@
 
 #pragma once
 
-#include "../Hex.hpp"
+#include "../Key.hpp"
 
 namespace Casc
 {
@@ -40,7 +40,7 @@ namespace Casc
             size_t size;
 
             // The checksum of the data.
-            Hex checksum;
+            Key checksum;
 
             bool operator <(const Chunk &b) const
             {
@@ -0,0 +1,272 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace Casc
+{
+    namespace IO
+    {
+        /**
+         * A cache of decoded chunks, shared by all streams of a container.
+         *
+         * The cache is split into shards with their own locks and budgets. Each shard is a
+         * segmented LRU: new chunks start out on probation and are only protected once they're
+         * hit again, so a scan through many files once doesn't push out the hot set.
+         */
+        class ChunkCache
+        {
+        public:
+            /**
+             * Identifies a chunk by the encoding key of its file and its index in the block table.
+             */
+            struct Key
+            {
+                // The encoding key of the file.
+                std::array<uint8_t, 16> ekey;
+
+                // The index of the chunk.
+                size_t index;
+
+                bool operator ==(const Key &b) const
+                {
+                    return index == b.index && ekey == b.ekey;
+                }
+            };
+
+            typedef std::shared_ptr<const std::vector<char>> value_type;
+
+            // The default number of shards.
+            static const size_t DefaultShards = 16U;
+
+        private:
+            struct KeyHash
+            {
+                size_t operator()(const Key &key) const
+                {
+                    // The encoding key is an MD5 hash, so its bytes are already well mixed.
+                    uint64_t h;
+                    std::memcpy(&h, key.ekey.data(), sizeof(h));
+
+                    return static_cast<size_t>(h ^ (key.index * 0x9E3779B97F4A7C15ULL));
+                }
+            };
+
+            struct Entry
+            {
+                // The key of the chunk.
+                Key key;
+
+                // The decoded chunk.
+                value_type value;
+
+                // True when the chunk is in the protected segment.
+                bool protect;
+            };
+
+            typedef std::list<Entry> list_type;
+
+            struct Shard
+            {
+                // Guards the shard.
+                std::mutex lock;
+
+                // Chunks that have been used once, most recently used first.
+                list_type probation;
+
+                // Chunks that have been used more than once, most recently used first.
+                list_type protect;
+
+                // The entries by key.
+                std::unordered_map<Key, list_type::iterator, KeyHash> entries;
+
+                // The bytes held in each segment.
+                size_t probationSize = 0;
+                size_t protectSize = 0;
+            };
+
+            // The byte budget of a shard.
+            size_t shardCapacity;
+
+            // The byte budget of the protected segment of a shard.
+            size_t protectCapacity;
+
+            // The shards.
+            std::vector<std::unique_ptr<Shard>> shards;
+
+            Shard &shard(const Key &key)
+            {
+                return *shards[KeyHash()(key) % shards.size()];
+            }
+
+            /**
+             * Moves the least recently used protected chunks back to probation until the protected segment fits.
+             * The shard must be locked.
+             */
+            void demote(Shard &shard)
+            {
+                while (shard.protectSize > protectCapacity && !shard.protect.empty())
+                {
+                    auto it = std::prev(shard.protect.end());
+                    auto size = it->value->size();
+
+                    it->protect = false;
+                    shard.probation.splice(shard.probation.begin(), shard.protect, it);
+
+                    shard.protectSize -= size;
+                    shard.probationSize += size;
+                }
+            }
+
+            /**
+             * Drops the least recently used chunks on probation until the shard fits.
+             * The shard must be locked.
+             */
+            void evict(Shard &shard)
+            {
+                while (shard.probationSize + shard.protectSize > shardCapacity && !shard.probation.empty())
+                {
+                    auto &entry = shard.probation.back();
+
+                    shard.probationSize -= entry.value->size();
+                    shard.entries.erase(entry.key);
+                    shard.probation.pop_back();
+                }
+            }
+
+        public:
+            /**
+             * Constructor.
+             */
+            ChunkCache(size_t capacity, size_t shardCount = DefaultShards)
+                : shardCapacity(capacity / (shardCount > 0 ? shardCount : 1)),
+                  protectCapacity(shardCapacity / 5 * 4)
+            {
+                shards.resize(shardCount > 0 ? shardCount : 1);
+
+                for (auto &shard : shards)
+                {
+                    shard = std::make_unique<Shard>();
+                }
+            }
+
+            /**
+             * Copy constructor (deleted).
+             */
+            ChunkCache(const ChunkCache &) = delete;
+
+            /**
+             * Copy operator (deleted).
+             */
+            ChunkCache &operator= (const ChunkCache &) = delete;
+
+            /**
+             * Destructor.
+             */
+            virtual ~ChunkCache() = default;
+
+            /**
+             * Finds a decoded chunk. Returns nullptr if the chunk isn't cached.
+             */
+            value_type find(const Key &key)
+            {
+                auto &s = shard(key);
+                std::lock_guard<std::mutex> guard(s.lock);
+
+                auto it = s.entries.find(key);
+
+                if (it == s.entries.end())
+                {
+                    return nullptr;
+                }
+
+                auto entry = it->second;
+                auto size = entry->value->size();
+
+                if (entry->protect)
+                {
+                    s.protect.splice(s.protect.begin(), s.protect, entry);
+                }
+                else
+                {
+                    entry->protect = true;
+                    s.protect.splice(s.protect.begin(), s.probation, entry);
+
+                    s.probationSize -= size;
+                    s.protectSize += size;
+
+                    demote(s);
+                }
+
+                return entry->value;
+            }
+
+            /**
+             * Adds a decoded chunk. Chunks larger than a shard's budget aren't cached.
+             */
+            void insert(const Key &key, value_type value)
+            {
+                if (value == nullptr || value->size() > shardCapacity)
+                {
+                    return;
+                }
+
+                auto &s = shard(key);
+                std::lock_guard<std::mutex> guard(s.lock);
+
+                if (s.entries.find(key) != s.entries.end())
+                {
+                    return;
+                }
+
+                s.probation.push_front({ key, value, false });
+                s.entries[key] = s.probation.begin();
+                s.probationSize += value->size();
+
+                evict(s);
+            }
+
+            /**
+             * The number of bytes held by the cache.
+             */
+            size_t size()
+            {
+                size_t total = 0;
+
+                for (auto &shard : shards)
+                {
+                    std::lock_guard<std::mutex> guard(shard->lock);
+                    total += shard->probationSize + shard->protectSize;
+                }
+
+                return total;
+            }
+        };
+    }
+}
\ No newline at end of file
@@ -23,6 +23,8 @@
 
 #include "../zlib.hpp"
 
+#include "Span.hpp"
+
 namespace Casc
 {
     namespace IO
@@ -33,7 +35,8 @@ namespace Casc
         enum class DataSourceType
         {
             MemoryMapped,
-            Stream
+            Stream,
+            File
         };
 
         /**
@@ -55,9 +58,19 @@ namespace Casc
             virtual ~DataSource() { }
 
             /**
-             * Gets a chunk of data.
+             * Copies a chunk of data into the output span.
+             * Returns the number of bytes copied.
+             */
+            virtual size_t read(size_t offset, Span<char> out) = 0;
+
+            /**
+             * Gets a view of a chunk of data without copying it.
+             * Returns an empty span if the source can't hand out views.
              */
-            virtual std::vector<char> get(size_t offset, size_t count) = 0;
+            virtual Span<const char> view(size_t /*offset*/, size_t /*count*/)
+            {
+                return Span<const char>();
+            }
 
             /**
              * The type of data source.
@@ -77,5 +90,6 @@ namespace Casc
     }
 }
 
+#include "Impl/FileSource.hpp"
 #include "Impl/MemoryMappedSource.hpp"
 #include "Impl/StreamSource.hpp"
\ No newline at end of file
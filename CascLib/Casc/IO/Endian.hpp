@@ -23,10 +23,13 @@
 #include <array>
 #include <bitset>
 #include <cctype>
+#include <cstring>
 #include <fstream>
 #include <iterator>
 #include <sstream>
+#include <stdint.h>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -37,55 +40,198 @@
 
 #include "EndianType.hpp"
 
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+#if defined(_MSC_VER) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define CASC_LITTLE_ENDIAN_HOST
+#endif
+
 namespace Casc
 {
     namespace IO
     {
         namespace Endian
         {
-            template <IO::EndianType Type, typename T, typename InputIt>
-            inline T read(InputIt first, InputIt last)
+            namespace Impl
             {
-                using namespace Casc::Exceptions;
+                inline uint8_t byteSwap(uint8_t value)
+                {
+                    return value;
+                }
+
+                inline uint16_t byteSwap(uint16_t value)
+                {
+#ifdef _MSC_VER
+                    return _byteswap_ushort(value);
+#else
+                    return __builtin_bswap16(value);
+#endif
+                }
+
+                inline uint32_t byteSwap(uint32_t value)
+                {
+#ifdef _MSC_VER
+                    return _byteswap_ulong(value);
+#else
+                    return __builtin_bswap32(value);
+#endif
+                }
+
+                inline uint64_t byteSwap(uint64_t value)
+                {
+#ifdef _MSC_VER
+                    return _byteswap_uint64(value);
+#else
+                    return __builtin_bswap64(value);
+#endif
+                }
+
+                /**
+                 * The unsigned integer of a size, if there's one to load and swap.
+                 */
+                template <size_t Size>
+                struct Unsigned { };
+
+                template <>
+                struct Unsigned<1> { typedef uint8_t type; };
+
+                template <>
+                struct Unsigned<2> { typedef uint16_t type; };
+
+                template <>
+                struct Unsigned<4> { typedef uint32_t type; };
+
+                template <>
+                struct Unsigned<8> { typedef uint64_t type; };
+
+                /**
+                 * Whether a value of type T can be loaded from an iterator in one go:
+                 * T is a fixed-width integer, and the iterator points into contiguous bytes.
+                 */
+                template <typename T, typename InputIt>
+                struct IsLoadable
+                {
+                    typedef typename std::iterator_traits<InputIt>::value_type byte_type;
+
+                    static const bool value =
+#ifdef CASC_LITTLE_ENDIAN_HOST
+                        std::is_integral<T>::value &&
+                        (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8) &&
+                        std::is_integral<byte_type>::value && sizeof(byte_type) == 1 &&
+                        !std::is_same<byte_type, bool>::value &&
+                        (std::is_pointer<InputIt>::value ||
+                            std::is_same<InputIt, typename std::vector<byte_type>::iterator>::value ||
+                            std::is_same<InputIt, typename std::vector<byte_type>::const_iterator>::value);
+#else
+                        false;
+#endif
+                };
+
+                /**
+                 * Loads a value with a single unaligned load, swapping the bytes if the order differs from the host's.
+                 */
+                template <IO::EndianType Type, typename T>
+                inline T load(const void *data)
+                {
+                    typename Unsigned<sizeof(T)>::type value;
+                    std::memcpy(&value, data, sizeof(value));
+
+                    return static_cast<T>(Type == IO::EndianType::Little ? value : byteSwap(value));
+                }
+
+                /**
+                 * Stores a value with a single unaligned store, swapping the bytes if the order differs from the host's.
+                 */
+                template <IO::EndianType Type, typename T>
+                inline void store(T value, void *data)
+                {
+                    auto bits = static_cast<typename Unsigned<sizeof(T)>::type>(value);
+                    bits = Type == IO::EndianType::Little ? bits : byteSwap(bits);
+
+                    std::memcpy(data, &bits, sizeof(bits));
+                }
+
+                /**
+                 * Reads a value of any number of bytes one byte at a time.
+                 */
+                template <typename T, typename InputIt>
+                inline T readBytes(InputIt first, InputIt last, std::integral_constant<IO::EndianType, IO::EndianType::Little>)
+                {
+                    typedef typename std::make_unsigned<T>::type unsigned_type;
+                    typedef typename std::make_unsigned<typename std::iterator_traits<InputIt>::value_type>::type byte_type;
 
-                T output{};
-                auto it = first;
+                    unsigned_type output = 0;
 
-                typedef const typename std::make_unsigned<typename std::iterator_traits<InputIt>::value_type>::type* unsigned_ptr;
-                typedef const typename std::make_signed<typename std::iterator_traits<InputIt>::value_type>::type* signed_ptr;
+                    for (auto it = first; it != last; ++it)
+                    {
+                        output |= static_cast<unsigned_type>(static_cast<byte_type>(*it)) << (it - first) * 8;
+                    }
 
-                switch (Type)
+                    return static_cast<T>(output);
+                }
+
+                /**
+                 * Reads a value of any number of bytes one byte at a time.
+                 */
+                template <typename T, typename InputIt>
+                inline T readBytes(InputIt first, InputIt last, std::integral_constant<IO::EndianType, IO::EndianType::Big>)
                 {
-                case IO::EndianType::Little:
-                    for (it = first; it != last; ++it)
+                    typedef typename std::make_unsigned<T>::type unsigned_type;
+                    typedef typename std::make_unsigned<typename std::iterator_traits<InputIt>::value_type>::type byte_type;
+
+                    unsigned_type output = 0;
+
+                    for (auto it = first; it != last; ++it)
                     {
-                        if (std::is_unsigned<T>::value)
-                        {
-                            output |= *reinterpret_cast<unsigned_ptr>(&*it) << (it - first) * 8;
-                        }
-                        else if (std::is_signed<T>::value)
-                        {
-                            output |= *reinterpret_cast<signed_ptr>(&*it) << (it - first) * 8;
-                        }
+                        output |= static_cast<unsigned_type>(static_cast<byte_type>(*it)) << ((last - first - 1) - (it - first)) * 8;
                     }
-                    break;
 
-                case IO::EndianType::Big:
-                    for (it = last - 1; it >= first; --it)
+                    return static_cast<T>(output);
+                }
+
+                template <IO::EndianType Type, typename T, typename InputIt>
+                inline T read(InputIt first, InputIt last, std::true_type)
+                {
+                    if (size_t(last - first) == sizeof(T))
                     {
-                        if (std::is_unsigned<T>::value)
-                        {
-                            output |= *reinterpret_cast<unsigned_ptr>(&*it) << ((sizeof(T) - 1) - (it - first)) * 8;
-                        }
-                        else if (std::is_signed<T>::value)
-                        {
-                            output |= *reinterpret_cast<signed_ptr>(&*it) << ((sizeof(T) - 1) - (it - first)) * 8;
-                        }
+                        return load<Type, T>(&*first);
                     }
-                    break;
+
+                    return readBytes<T>(first, last, std::integral_constant<IO::EndianType, Type>());
                 }
 
-                return output;
+                template <IO::EndianType Type, typename T, typename InputIt>
+                inline T read(InputIt first, InputIt last, std::false_type)
+                {
+                    return readBytes<T>(first, last, std::integral_constant<IO::EndianType, Type>());
+                }
+
+                template <IO::EndianType Type, typename T>
+                inline void write(T value, char *output, std::true_type)
+                {
+                    store<Type>(value, output);
+                }
+
+                template <IO::EndianType Type, typename T>
+                inline void write(T value, char *output, std::false_type)
+                {
+                    for (size_t i = 0; i < sizeof(T); ++i)
+                    {
+                        output[Type == IO::EndianType::Little ? i : (sizeof(T) - 1) - i] = (value >> i * 8) & 0xFF;
+                    }
+                }
+            }
+
+            /**
+             * Reads an integer stored in the bytes of a range. Ranges of the size of T are read with a single load
+             * when the bytes are contiguous, and byte by byte otherwise.
+             */
+            template <IO::EndianType Type, typename T, typename InputIt>
+            inline T read(InputIt first, InputIt last)
+            {
+                return Impl::read<Type, T>(first, last, std::integral_constant<bool, Impl::IsLoadable<T, InputIt>::value>());
             }
 
             template <IO::EndianType Type, typename T, typename InputIt>
@@ -109,24 +255,8 @@ namespace Casc
             inline std::array<char, sizeof(T)> write(T value)
             {
                 std::array<char, sizeof(T)> output{};
-                int i;
-
-                switch (Type)
-                {
-                case IO::EndianType::Little:
-                    for (i = 0; i < sizeof(T); ++i)
-                    {
-                        output[i] = (value >> i * 8) & 0xFF;
-                    }
-                    break;
 
-                case IO::EndianType::Big:
-                    for (i = 0; i < sizeof(T); ++i)
-                    {
-                        output[(sizeof(T) - 1) - i] = (value >> i * 8) & 0xFF;
-                    }
-                    break;
-                }
+                Impl::write<Type>(value, output.data(), std::integral_constant<bool, Impl::IsLoadable<T, char*>::value>());
 
                 return output;
             }
@@ -0,0 +1,242 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#ifdef _MSC_VER
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../Exceptions.hpp"
+
+#include "AccessPattern.hpp"
+#include "Span.hpp"
+
+namespace Casc
+{
+    namespace IO
+    {
+        /**
+         * A read-only file descriptor with positional reads.
+         */
+        class File
+        {
+        public:
+#ifdef _MSC_VER
+            typedef HANDLE native_handle_type;
+#else
+            typedef int native_handle_type;
+#endif
+
+        private:
+            // The native file handle.
+            native_handle_type handle;
+
+        public:
+            /**
+             * Constructor. Takes ownership of an open native handle.
+             */
+            explicit File(native_handle_type handle)
+                : handle(handle)
+            {
+            }
+
+            /**
+             * Constructor. Opens a file for reading.
+             */
+            File(const std::string &path)
+            {
+#ifdef _MSC_VER
+                handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                    nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+                if (handle == INVALID_HANDLE_VALUE)
+                {
+                    throw Exceptions::FileNotFoundException(path);
+                }
+#else
+                handle = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+                if (handle < 0)
+                {
+                    throw Exceptions::FileNotFoundException(path);
+                }
+#endif
+            }
+
+            /**
+             * Copy constructor (deleted).
+             */
+            File(const File &) = delete;
+
+            /**
+             * Copy operator (deleted).
+             */
+            File &operator= (const File &) = delete;
+
+            /**
+             * Destructor.
+             */
+            virtual ~File()
+            {
+#ifdef _MSC_VER
+                CloseHandle(handle);
+#else
+                ::close(handle);
+#endif
+            }
+
+            /**
+             * The native file handle.
+             */
+            native_handle_type native_handle() const
+            {
+                return handle;
+            }
+
+            /**
+             * The current size of the file.
+             */
+            size_t size() const
+            {
+#ifdef _MSC_VER
+                LARGE_INTEGER size;
+
+                if (!GetFileSizeEx(handle, &size))
+                {
+                    throw Exceptions::IOException("Couldn't get the size of the file.");
+                }
+
+                return static_cast<size_t>(size.QuadPart);
+#else
+                struct stat st;
+
+                if (fstat(handle, &st) != 0)
+                {
+                    throw Exceptions::IOException("Couldn't get the size of the file.");
+                }
+
+                return static_cast<size_t>(st.st_size);
+#endif
+            }
+
+            /**
+             * Reads bytes from an offset into the output span.
+             * Returns the number of bytes read, which is only less than requested at the end of the file.
+             * Reads are positional and don't move a shared cursor, so any number of threads may read at once.
+             */
+            size_t read(size_t offset, Span<char> out) const
+            {
+                size_t count = 0;
+
+                while (count < out.size())
+                {
+                    auto position = offset + count;
+                    auto remaining = out.size() - count;
+#ifdef _MSC_VER
+                    OVERLAPPED overlapped = {};
+                    overlapped.Offset = static_cast<DWORD>(position);
+                    overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(position) >> 32);
+
+                    DWORD n = 0;
+
+                    if (!ReadFile(handle, out.data() + count,
+                        static_cast<DWORD>(remaining < 0x40000000U ? remaining : 0x40000000U), &n, &overlapped))
+                    {
+                        if (GetLastError() == ERROR_HANDLE_EOF)
+                        {
+                            break;
+                        }
+
+                        throw Exceptions::IOException("Couldn't read from the file.");
+                    }
+#else
+                    auto n = ::pread(handle, out.data() + count, remaining, static_cast<off_t>(position));
+
+                    if (n < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+
+                        throw Exceptions::IOException("Couldn't read from the file.");
+                    }
+#endif
+
+                    if (n == 0)
+                    {
+                        break;
+                    }
+
+                    count += static_cast<size_t>(n);
+                }
+
+                return count;
+            }
+
+            /**
+             * Tells the OS how a range of the file will be read. The hint may be ignored.
+             * Only hints that stay within the range are passed on: the read-ahead hints (POSIX_FADV_RANDOM and
+             * POSIX_FADV_SEQUENTIAL) apply to the whole descriptor, which is shared by every stream of a data file.
+             * Windows only takes hints when a file is opened, so this does nothing there.
+             */
+            void advise(size_t offset, size_t size, AccessPattern pattern) const
+            {
+#if !defined(_MSC_VER) && defined(POSIX_FADV_WILLNEED)
+                switch (pattern)
+                {
+                case AccessPattern::Normal:
+                case AccessPattern::Random:
+                    break;
+
+                case AccessPattern::Sequential:
+                case AccessPattern::Once:
+                    ::posix_fadvise(handle, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+                    break;
+                }
+#endif
+            }
+
+            /**
+             * Tells the OS a range of the file won't be read again, so it can be dropped from the page cache.
+             */
+            void release(size_t offset, size_t size) const
+            {
+#if !defined(_MSC_VER) && defined(POSIX_FADV_DONTNEED)
+                ::posix_fadvise(handle, static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_DONTNEED);
+#endif
+            }
+        };
+    }
+}
\ No newline at end of file
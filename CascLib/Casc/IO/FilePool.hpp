@@ -0,0 +1,209 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../Common.hpp"
+#include "../Exceptions.hpp"
+
+#include "File.hpp"
+#include "MappedFile.hpp"
+
+namespace Casc
+{
+    namespace IO
+    {
+        /**
+         * Keeps a bounded number of data files open, so opening a file in the
+         * container doesn't need to open, stat or look up its data file.
+         * Files are closed least recently used first; streams that still
+         * borrow a closed file keep it alive until they're done.
+         */
+        class FilePool
+        {
+        public:
+            // The default number of data files kept open.
+            static const size_t DefaultCapacity = 128U;
+
+        private:
+            struct Entry
+            {
+                // The open data file.
+                std::shared_ptr<File> file;
+
+                // The mapping of the data file, if it has been mapped.
+                std::shared_ptr<const MappedFile> mapping;
+
+                // The position in the recently used list.
+                std::list<uint32_t>::iterator age;
+            };
+
+            // The path of the data directory.
+            std::string path;
+
+#ifndef _MSC_VER
+            // The data directory, which data files are opened relative to.
+            int directory = -1;
+#endif
+
+            // The maximum number of open data files.
+            size_t capacity;
+
+            // The open data files, by file number.
+            std::unordered_map<uint32_t, Entry> entries;
+
+            // The file numbers, most recently used first.
+            std::list<uint32_t> ages;
+
+            // Guards the pool.
+            std::mutex lock;
+
+            /**
+             * Opens a data file.
+             */
+            std::shared_ptr<File> open(uint32_t number)
+            {
+                char name[16];
+                std::snprintf(name, sizeof(name), "data.%03u", number);
+
+#ifdef _MSC_VER
+                return std::make_shared<File>(path + PathSeparator + name);
+#else
+                if (directory < 0)
+                {
+                    directory = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+                    if (directory < 0)
+                    {
+                        throw Exceptions::FileNotFoundException(path);
+                    }
+                }
+
+                auto fd = ::openat(directory, name, O_RDONLY | O_CLOEXEC);
+
+                if (fd < 0)
+                {
+                    throw Exceptions::FileNotFoundException(path + PathSeparator + name);
+                }
+
+                return std::make_shared<File>(fd);
+#endif
+            }
+
+            /**
+             * Gets the entry of a data file, opening it if needed.
+             * The pool must be locked.
+             */
+            Entry &acquire(uint32_t number)
+            {
+                auto it = entries.find(number);
+
+                if (it != entries.end())
+                {
+                    ages.splice(ages.begin(), ages, it->second.age);
+                    return it->second;
+                }
+
+                auto file = open(number);
+
+                while (entries.size() >= capacity && !ages.empty())
+                {
+                    entries.erase(ages.back());
+                    ages.pop_back();
+                }
+
+                ages.push_front(number);
+
+                auto &entry = entries[number];
+                entry.file = file;
+                entry.age = ages.begin();
+
+                return entry;
+            }
+
+        public:
+            /**
+             * Constructor.
+             */
+            FilePool(const std::string &path, size_t capacity = DefaultCapacity)
+                : path(path), capacity(capacity > 0 ? capacity : 1)
+            {
+            }
+
+            /**
+             * Copy constructor (deleted).
+             */
+            FilePool(const FilePool &) = delete;
+
+            /**
+             * Copy operator (deleted).
+             */
+            FilePool &operator= (const FilePool &) = delete;
+
+            /**
+             * Destructor.
+             */
+            virtual ~FilePool()
+            {
+#ifndef _MSC_VER
+                if (directory >= 0)
+                {
+                    ::close(directory);
+                }
+#endif
+            }
+
+            /**
+             * Gets an open data file.
+             */
+            std::shared_ptr<File> file(uint32_t number)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+
+                return acquire(number).file;
+            }
+
+            /**
+             * Gets a mapping of a data file that covers at least the given size.
+             */
+            std::shared_ptr<const MappedFile> mapping(uint32_t number, size_t size)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+
+                auto &entry = acquire(number);
+
+                // The data files grow while the game is running, so remap files
+                // when the requested range is outside the current mapping.
+                if (entry.mapping == nullptr || entry.mapping->size() < size)
+                {
+                    entry.mapping = std::make_shared<MappedFile>(*entry.file);
+                }
+
+                return entry.mapping;
+            }
+        };
+    }
+}
\ No newline at end of file
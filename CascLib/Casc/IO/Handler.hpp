@@ -19,11 +19,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <fstream>
 #include <memory>
+#include <vector>
 
 #include "../zlib.hpp"
-#include "../md5.hpp"
+#include "../Crypto/MD5.hpp"
 
 #include "Chunk.hpp"
 #include "DataSource.hpp"
@@ -64,9 +67,19 @@ namespace Casc
             virtual EncodingMode mode() const = 0;
 
             /**
-             * Decodes a chunk of data.
+             * Decodes a chunk of data into the output span.
+             * Returns the number of bytes decoded.
              */
-            virtual std::vector<char> decode(size_t offset, size_t count) = 0;
+            virtual size_t decode(size_t offset, Span<char> out) = 0;
+
+            /**
+             * Gets a view of decoded data without copying it.
+             * Returns an empty span if the data has to be decoded into a buffer.
+             */
+            virtual Span<const char> view(size_t /*offset*/, size_t /*count*/)
+            {
+                return Span<const char>();
+            }
 
             /**
              * Encodes data from the stream and returns the result.
@@ -84,14 +97,58 @@ namespace Casc
             virtual void reset() = 0;
 
             /**
-             * Checks the data against the MD5 checksum.
+             * Gets the whole decoded chunk if the handler holds it and it can be shared.
+             */
+            virtual std::shared_ptr<const std::vector<char>> shared() const
+            {
+                return nullptr;
+            }
+
+            /**
+             * Serves the chunk from data that has already been decoded.
+             * Returns false if the handler doesn't take shared data or the data doesn't fit the chunk.
+             */
+            virtual bool share(std::shared_ptr<const std::vector<char>> /*data*/)
+            {
+                return false;
+            }
+
+            /**
+             * Hashes the chunk, including its mode byte.
+             * Hashes the data in place when the source can hand out a view of it.
+             */
+            Crypto::MD5::digest_type hash() const
+            {
+                Crypto::MD5 hash;
+
+                auto data = this->source->view(0, SIZE_MAX);
+
+                if (!data.empty())
+                {
+                    hash.update(data.data(), data.size());
+                }
+                else
+                {
+                    std::array<char, 4096> block;
+                    size_t count;
+
+                    for (size_t offset = 0; (count = this->source->read(offset, { block.data(), block.size() })) > 0; offset += count)
+                    {
+                        hash.update(block.data(), count);
+                    }
+                }
+
+                return hash.digest();
+            }
+
+            /**
+             * Checks the chunk against the MD5 checksum in the block table.
              */
-            bool validate()
+            bool validate() const
             {
-                auto data = this->source->get(1, SIZE_MAX);
-                auto hash = Hex(md5(data));
+                auto digest = hash();
 
-                return hash == chunk.checksum;
+                return chunk.checksum == Key(digest.begin(), digest.end());
             }
         };
     }
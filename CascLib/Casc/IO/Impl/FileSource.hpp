@@ -0,0 +1,68 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+
+#include "../DataSource.hpp"
+#include "../File.hpp"
+#include "../../Exceptions.hpp"
+
+namespace Casc
+{
+    namespace IO
+    {
+        namespace Impl
+        {
+            /**
+             * A source for data backed by a range of a file.
+             */
+            class FileSource : public DataSource
+            {
+                std::shared_ptr<File> file;
+
+            public:
+                /**
+                 * Constructor.
+                 */
+                FileSource(std::shared_ptr<File> file, std::pair<size_t, size_t> bounds)
+                    : DataSource(DataSourceType::File, bounds), file(file)
+                {
+                }
+
+                /**
+                 * Copies a chunk of data into the output span.
+                 */
+                size_t read(size_t offset, Span<char> out) override
+                {
+                    if (offset > upper_bound - lower_bound)
+                    {
+                        throw Exceptions::IOException("Invalid offset");
+                    }
+
+                    auto count = std::min(out.size(), upper_bound - lower_bound - offset);
+
+                    return file->read(lower_bound + offset, out.subspan(0, count));
+                }
+            };
+        }
+    }
+}
\ No newline at end of file
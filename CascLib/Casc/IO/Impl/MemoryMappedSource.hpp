@@ -19,7 +19,12 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "../DataSource.hpp"
+#include "../MappedFile.hpp"
+#include "../../Exceptions.hpp"
 
 namespace Casc
 {
@@ -28,32 +33,71 @@ namespace Casc
         namespace Impl
         {
             /**
-             * A source for data.
+             * A source for data backed by memory, usually a mapped data file.
              */
             class MemoryMappedSource : public DataSource
             {
-                std::vector<char> buf;
+                // Keeps the memory alive.
+                std::shared_ptr<const void> owner;
+
+                // The first accessible byte.
+                const char *base;
 
             public:
                 /**
-                 * Constructor.
+                 * Constructor. The source owns a copy of the bytes.
                  */
                 MemoryMappedSource(std::vector<char> bytes) :
-                    DataSource(DataSourceType::MemoryMapped, { 0, bytes.size() }), buf(bytes)
-                { }
+                    DataSource(DataSourceType::MemoryMapped, { 0, bytes.size() })
+                {
+                    auto buf = std::make_shared<std::vector<char>>(std::move(bytes));
+                    base = buf->data();
+                    owner = buf;
+                }
+
+                /**
+                 * Constructor. The source is a range of shared bytes.
+                 */
+                MemoryMappedSource(std::shared_ptr<const std::vector<char>> bytes, std::pair<size_t, size_t> bounds) :
+                    DataSource(DataSourceType::MemoryMapped, bounds), owner(bytes), base(bytes->data() + bounds.first)
+                {
+                    if (bounds.first > bounds.second || bounds.second > bytes->size())
+                    {
+                        throw Exceptions::IOException("Source is outside the buffer.");
+                    }
+                }
 
                 /**
-                 * Gets a chunk of data.
+                 * Constructor. The source is a range of a mapped file.
                  */
-                std::vector<char> get(size_t offset, size_t count) override
+                MemoryMappedSource(std::shared_ptr<const MappedFile> file, std::pair<size_t, size_t> bounds) :
+                    DataSource(DataSourceType::MemoryMapped, bounds), owner(file), base(file->data() + bounds.first)
                 {
-                    auto begin = buf.begin() + offset;
-                    auto end = size_t(buf.end() - begin) > count ? begin + count : buf.end();
+                    if (bounds.first > bounds.second || bounds.second > file->size())
+                    {
+                        throw Exceptions::IOException("Source is outside the mapped file.");
+                    }
+                }
 
-                    return std::vector<char>(begin, end);
+                /**
+                 * Copies a chunk of data into the output span.
+                 */
+                size_t read(size_t offset, Span<char> out) override
+                {
+                    auto v = view(offset, out.size());
+
+                    std::memcpy(out.data(), v.data(), v.size());
+
+                    return v.size();
                 };
 
-                using DataSource::DataSource;
+                /**
+                 * Gets a view of a chunk of data without copying it.
+                 */
+                Span<const char> view(size_t offset, size_t count) override
+                {
+                    return Span<const char>(base, upper_bound - lower_bound).subspan(offset, count);
+                }
             };
         }
     }
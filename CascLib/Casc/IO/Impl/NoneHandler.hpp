@@ -44,9 +44,14 @@ namespace Casc
                     return EncodingMode::None;
                 }
 
-                std::vector<char> decode(size_t offset, size_t count) override
+                size_t decode(size_t offset, Span<char> out) override
                 {
-                    return source->get(offset + 1, count);
+                    return source->read(offset + 1, out);
+                }
+
+                Span<const char> view(size_t offset, size_t count) override
+                {
+                    return source->view(offset + 1, count);
                 }
 
                 std::vector<char> encode(std::vector<char> input) const override
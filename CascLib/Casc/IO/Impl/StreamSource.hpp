@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include "../DataSource.hpp"
 #include "../../Exceptions.hpp"
 
@@ -29,7 +31,9 @@ namespace Casc
         namespace Impl
         {
             /**
-             * A source for data.
+             * A source for data backed by a stream.
+             * Reads move the stream's cursor, so sources sharing a stream can't be read concurrently;
+             * data files are read through a FileSource instead.
              */
             class StreamSource : public DataSource
             {
@@ -46,27 +50,24 @@ namespace Casc
                     begin(bounds.first), end(bounds.second) { }
 
                 /**
-                 * Gets a chunk of data.
+                 * Copies a chunk of data into the output span.
                  */
-                std::vector<char> get(size_t offset, size_t count) override
+                size_t read(size_t offset, Span<char> out) override
                 {
-                    if (offset >= (end - begin))
+                    if (offset > (end - begin))
                     {
                         throw Exceptions::IOException("Invalid offset");
                     }
 
-                    auto available = end - begin - offset;
+                    auto count = std::min(out.size(), end - begin - offset);
 
-                    if (count > available)
+                    if (count > 0)
                     {
-                        count = available;
+                        stream->seekg(begin + offset, std::ios_base::beg);
+                        stream->read(out.data(), count);
                     }
 
-                    std::vector<char> v(count, '\0');
-                    stream->seekg(begin + offset, std::ios_base::beg);
-                    stream->read(v.data(), count);
-
-                    return v;
+                    return count;
                 }
 
                 using DataSource::DataSource;
@@ -19,8 +19,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
+#include <vector>
 
 #include "../../zlib.hpp"
 
@@ -38,35 +40,124 @@ namespace Casc
                 const int CompressionLevel = 9;
                 const int WindowBits = 15;
 
+                // How far ahead of a request to inflate, so small sequential reads don't call into zlib each time.
+                const size_t InflateStep = 0x10000U;
+
+                // The compressed data, when the source can't hand out a view of it.
+                std::vector<char> encoded;
+
+                // The inflate state, kept between requests until the chunk is fully inflated.
+                std::unique_ptr<ZInflateStream> stream;
+
+                // The decoded data while inflating. Only the first inflated bytes are valid.
                 std::vector<char> decoded;
 
-                Chunk constructChunk(std::shared_ptr<DataSource> source)
+                // The decoded data once the chunk is fully inflated. This may be shared with a chunk cache.
+                std::shared_ptr<const std::vector<char>> complete;
+
+                // The number of bytes inflated so far.
+                size_t inflated = 0;
+
+                // True once the whole chunk has been inflated.
+                bool finished = false;
+
+                /**
+                 * Inflates the whole chunk.
+                 */
+                static std::vector<char> inflate(std::shared_ptr<DataSource> source)
                 {
-                    auto decoded = decode(source);
-                    return{ 0, decoded.size(), 0, source->upper_bound - source->lower_bound };
+                    std::vector<char> buf;
+                    auto in = source->view(1, SIZE_MAX);
+
+                    if (in.empty())
+                    {
+                        buf.resize(source->upper_bound - source->lower_bound - 1);
+                        buf.resize(source->read(1, { buf.data(), buf.size() }));
+
+                        in = { buf.data(), buf.size() };
+                    }
+
+                    std::vector<char> decoded;
+
+                    ZInflateStream(reinterpret_cast<ZStreamBase::char_t*>(
+                        const_cast<char*>(in.data())), in.size()).readAll(decoded);
+
+                    return decoded;
                 }
 
-                std::vector<char> decode(std::shared_ptr<DataSource> source)
+                /**
+                 * Inflates the chunk up to at least the given size, resuming where the last call stopped.
+                 */
+                void inflateTo(size_t size)
                 {
-                    auto in = source->get(1, SIZE_MAX);
+                    if (finished || inflated >= size)
+                    {
+                        return;
+                    }
 
-                    std::vector<char> decoded;
+                    if (stream == nullptr)
+                    {
+                        auto in = source->view(1, SIZE_MAX);
+
+                        if (in.empty())
+                        {
+                            encoded.resize(source->upper_bound - source->lower_bound - 1);
+                            encoded.resize(source->read(1, { encoded.data(), encoded.size() }));
+
+                            in = { encoded.data(), encoded.size() };
+                        }
+
+                        stream = std::make_unique<ZInflateStream>(reinterpret_cast<ZStreamBase::char_t*>(
+                            const_cast<char*>(in.data())), in.size());
 
-                    if (decoded.size() == 0)
+                        decoded.resize(chunk.end - chunk.begin);
+                    }
+
+                    size = std::max(size, inflated + InflateStep);
+
+                    while (!finished && inflated < size)
                     {
-                        ZStreamBase::char_t* out = nullptr;
-                        size_t avail_out = 0;
+                        // The logical size is unknown or wrong, so grow the buffer.
+                        if (inflated == decoded.size())
+                        {
+                            decoded.resize(std::max(decoded.size() * 2, inflated + InflateStep));
+                        }
 
-                        ZInflateStream(reinterpret_cast<unsigned char*>(
-                            in.data()), in.size()).readAll(&out, avail_out);
+                        auto count = stream->readSome(reinterpret_cast<ZStreamBase::char_t*>(decoded.data() + inflated),
+                            std::min(size, decoded.size()) - inflated);
 
-                        decoded.resize(avail_out);
-                        std::memcpy(decoded.data(), out, avail_out);
+                        inflated += count;
 
-                        delete out;
+                        // No progress means the compressed data is truncated.
+                        finished = stream->isStreamEnd() || count == 0;
                     }
 
-                    return decoded;
+                    if (finished)
+                    {
+                        stream = nullptr;
+                        encoded = std::vector<char>();
+                        decoded.resize(inflated);
+                        complete = std::make_shared<const std::vector<char>>(std::move(decoded));
+                        decoded = std::vector<char>();
+                    }
+                }
+
+                /**
+                 * The decoded data.
+                 */
+                const char *data() const
+                {
+                    return complete != nullptr ? complete->data() : decoded.data();
+                }
+
+                /**
+                 * Constructor for a chunk that has already been inflated.
+                 */
+                ZlibHandler(std::shared_ptr<DataSource> source, std::vector<char> &&decoded) :
+                    Handler({ 0, decoded.size(), 0, source->upper_bound - source->lower_bound }, source),
+                    complete(std::make_shared<const std::vector<char>>(std::move(decoded))),
+                    inflated(complete->size()), finished(true)
+                {
                 }
 
             public:
@@ -75,51 +166,53 @@ namespace Casc
                     return EncodingMode::Zlib;
                 }
 
-                std::vector<char> decode(size_t offset, size_t count) override
+                size_t decode(size_t offset, Span<char> out) override
                 {
-                    if (decoded.size() == 0)
+                    inflateTo(offset + out.size());
+
+                    if (offset >= inflated)
                     {
-                        decoded = decode(source);
+                        throw Exceptions::IOException("Invalid offset.");
                     }
 
-                    if (offset >= decoded.size())
+                    auto count = std::min(out.size(), inflated - offset);
+
+                    std::memcpy(out.data(), data() + offset, count);
+
+                    return count;
+                }
+
+                Span<const char> view(size_t offset, size_t count) override
+                {
+                    inflateTo(offset + std::min(count, InflateStep));
+
+                    if (offset >= inflated)
                     {
                         throw Exceptions::IOException("Invalid offset.");
                     }
 
-                    auto begin = decoded.begin() + offset;
-                    auto end = size_t(decoded.end() - begin) < count ? decoded.end() : begin + count;
-
-                    return { begin, end };
+                    return Span<const char>(data(), inflated).subspan(offset, count);
                 }
 
                 std::vector<char> encode(std::vector<char> input) const override
                 {
                     ZDeflateStream zstream(this->CompressionLevel);
                     zstream.write(reinterpret_cast<ZStreamBase::char_t*>(input.data()), input.size());
+                    zstream.flush();
 
-                    char* buf;
-                    size_t bufSize;
-
-                    zstream.readAll(reinterpret_cast<ZStreamBase::char_t**>(&buf), bufSize);
+                    std::vector<char> v(1, char(mode()));
+                    zstream.readAll(v);
 
-                    std::vector<char> v(bufSize + 1, '\0');
-                    std::memcpy(v.data() + 1, buf, bufSize);
-                    v[0] = mode();
-
-                    return std::move(v);
+                    return v;
                 }
 
                 size_t logicalSize() override
                 {
                     if (chunk.end == chunk.begin)
                     {
-                        if (decoded.size() == 0)
-                        {
-                            return decode(0, source->upper_bound - source->lower_bound).size();
-                        }
+                        inflateTo(SIZE_MAX);
 
-                        return decoded.size();
+                        return inflated;
                     }
 
                     return chunk.end - chunk.begin;
@@ -127,13 +220,42 @@ namespace Casc
 
                 void reset() override
                 {
-                    decoded.clear();
+                    stream = nullptr;
+                    encoded = std::vector<char>();
+                    decoded = std::vector<char>();
+                    complete = nullptr;
+                    inflated = 0;
+                    finished = false;
                 }
 
-                ZlibHandler(std::shared_ptr<DataSource> source) :
-                    Handler(constructChunk(source), source)
+                std::shared_ptr<const std::vector<char>> shared() const override
                 {
+                    return complete;
+                }
 
+                bool share(std::shared_ptr<const std::vector<char>> data) override
+                {
+                    if (data == nullptr || (chunk.end != chunk.begin && data->size() != chunk.end - chunk.begin))
+                    {
+                        return false;
+                    }
+
+                    reset();
+
+                    complete = data;
+                    inflated = data->size();
+                    finished = true;
+
+                    return true;
+                }
+
+                /**
+                 * Constructor for a chunk without a block table. The logical size is
+                 * only known once the data has been inflated, so this inflates it up front.
+                 */
+                ZlibHandler(std::shared_ptr<DataSource> source) :
+                    ZlibHandler(source, inflate(source))
+                {
                 }
 
                 using Handler::Handler;
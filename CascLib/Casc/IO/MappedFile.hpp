@@ -0,0 +1,239 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+
+#ifdef _MSC_VER
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../Exceptions.hpp"
+
+#include "AccessPattern.hpp"
+#include "File.hpp"
+#include "Span.hpp"
+
+namespace Casc
+{
+    namespace IO
+    {
+        /**
+         * A read-only memory mapping of an entire file.
+         */
+        class MappedFile
+        {
+        private:
+            // The start of the mapping.
+            const char *data_ = nullptr;
+
+            // The size of the mapping.
+            size_t size_ = 0;
+
+#ifdef _MSC_VER
+            // The mapping object.
+            HANDLE mapping = nullptr;
+#endif
+
+#ifndef _MSC_VER
+            /**
+             * Passes advice on a range of the mapping to the OS.
+             * The range is widened to whole pages and clamped to the mapping.
+             */
+            void advise(size_t offset, size_t size, int advice) const
+            {
+                static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+
+                if (data_ == nullptr || offset >= size_)
+                {
+                    return;
+                }
+
+                auto first = offset - offset % page;
+                auto last = size < size_ - offset ? offset + size : size_;
+
+                ::madvise(const_cast<char*>(data_) + first, last - first, advice);
+            }
+#endif
+
+            /**
+             * Unmaps the file.
+             */
+            void unmap()
+            {
+#ifdef _MSC_VER
+                if (data_ != nullptr)
+                {
+                    UnmapViewOfFile(data_);
+                }
+
+                if (mapping != nullptr)
+                {
+                    CloseHandle(mapping);
+                }
+
+                mapping = nullptr;
+#else
+                if (data_ != nullptr)
+                {
+                    munmap(const_cast<char*>(data_), size_);
+                }
+#endif
+                data_ = nullptr;
+                size_ = 0;
+            }
+
+        public:
+            /**
+             * Constructor. Maps the whole file.
+             */
+            MappedFile(const File &file)
+                : size_(file.size())
+            {
+                if (size_ == 0)
+                {
+                    return;
+                }
+
+#ifdef _MSC_VER
+                mapping = CreateFileMappingA(file.native_handle(), nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+                if (mapping != nullptr)
+                {
+                    data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                }
+
+                if (data_ == nullptr)
+                {
+                    unmap();
+                    throw Exceptions::IOException("Couldn't map file.");
+                }
+#else
+                auto addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file.native_handle(), 0);
+
+                if (addr == MAP_FAILED)
+                {
+                    size_ = 0;
+                    throw Exceptions::IOException("Couldn't map file.");
+                }
+
+                data_ = static_cast<const char*>(addr);
+#endif
+            }
+
+            /**
+             * Constructor. Maps the whole file.
+             * The mapping stays valid after the file is closed.
+             */
+            MappedFile(const std::string &path)
+                : MappedFile(File(path))
+            {
+            }
+
+            /**
+             * Copy constructor (deleted).
+             */
+            MappedFile(const MappedFile &) = delete;
+
+            /**
+             * Copy operator (deleted).
+             */
+            MappedFile &operator= (const MappedFile &) = delete;
+
+            /**
+             * Destructor.
+             */
+            virtual ~MappedFile()
+            {
+                unmap();
+            }
+
+            /**
+             * The start of the mapped file.
+             */
+            const char *data() const
+            {
+                return data_;
+            }
+
+            /**
+             * The size of the mapped file.
+             */
+            size_t size() const
+            {
+                return size_;
+            }
+
+            /**
+             * Gets a view of a range of the file. The view is clamped to the end of the file.
+             */
+            Span<const char> view(size_t offset, size_t count) const
+            {
+                return Span<const char>(data_, size_).subspan(offset, count);
+            }
+
+            /**
+             * Tells the OS how a range of the mapping will be read. The hint may be ignored.
+             */
+            void advise(size_t offset, size_t size, AccessPattern pattern) const
+            {
+#ifndef _MSC_VER
+                switch (pattern)
+                {
+                case AccessPattern::Normal:
+                    break;
+
+                case AccessPattern::Random:
+                    advise(offset, size, MADV_RANDOM);
+                    break;
+
+                case AccessPattern::Sequential:
+                case AccessPattern::Once:
+                    advise(offset, size, MADV_SEQUENTIAL);
+                    advise(offset, size, MADV_WILLNEED);
+                    break;
+                }
+#endif
+            }
+
+            /**
+             * Tells the OS a range of the mapping won't be read again.
+             * Where the OS supports it the pages are reclaimed, not just unmapped, so they leave the page cache too.
+             */
+            void release(size_t offset, size_t size) const
+            {
+#if defined(MADV_PAGEOUT)
+                advise(offset, size, MADV_PAGEOUT);
+#elif !defined(_MSC_VER)
+                advise(offset, size, MADV_DONTNEED);
+#endif
+            }
+        };
+    }
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Span.hpp"
+
+namespace Casc
+{
+    namespace IO
+    {
+        /**
+         * A read-only view of a contiguous range of elements that keeps the memory it points into alive.
+         * The memory is either a vector it took over or a shared buffer, such as a mapped file.
+         */
+        template <typename T>
+        class SharedSpan
+        {
+        public:
+            typedef const T value_type;
+            typedef const T *iterator;
+
+        private:
+            // Keeps the elements alive.
+            std::shared_ptr<const void> owner;
+
+            // The elements.
+            Span<const T> elements;
+
+        public:
+            /**
+             * Default constructor. Creates an empty span.
+             */
+            SharedSpan() { }
+
+            /**
+             * Constructor. Takes over the elements of a vector.
+             */
+            SharedSpan(std::vector<T> &&vector)
+            {
+                auto shared = std::make_shared<const std::vector<T>>(std::move(vector));
+
+                elements = Span<const T>(shared->data(), shared->size());
+                owner = std::move(shared);
+            }
+
+            /**
+             * Constructor. Views elements in memory kept alive by the owner.
+             */
+            SharedSpan(std::shared_ptr<const void> owner, Span<const T> elements)
+                : owner(std::move(owner)), elements(elements)
+            {
+            }
+
+            const T *data() const noexcept
+            {
+                return elements.data();
+            }
+
+            size_t size() const noexcept
+            {
+                return elements.size();
+            }
+
+            bool empty() const noexcept
+            {
+                return elements.empty();
+            }
+
+            iterator begin() const noexcept
+            {
+                return elements.begin();
+            }
+
+            iterator end() const noexcept
+            {
+                return elements.end();
+            }
+
+            const T &operator[](size_t index) const
+            {
+                return elements[index];
+            }
+
+            /**
+             * The elements, without the owner.
+             */
+            Span<const T> span() const noexcept
+            {
+                return elements;
+            }
+        };
+    }
+}
\ No newline at end of file
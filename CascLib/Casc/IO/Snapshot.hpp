@@ -0,0 +1,357 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "../Exceptions.hpp"
+#include "../Key.hpp"
+
+#include "MappedFile.hpp"
+#include "SharedSpan.hpp"
+#include "Span.hpp"
+
+namespace Casc
+{
+    namespace IO
+    {
+        namespace Impl
+        {
+            /**
+             * The start of a snapshot file.
+             */
+            struct SnapshotHeader
+            {
+                // The file signature.
+                char signature[8];
+
+                // The version of the format. Bumped whenever the layout of a stored table changes.
+                uint32_t version;
+
+                // A known value in the byte order of the writer, so snapshots aren't used across byte orders.
+                uint32_t byteOrder;
+
+                // What the snapshot was made from. Opening a snapshot fails unless this matches.
+                Key id;
+
+                // The number of sections.
+                uint64_t sectionCount;
+
+                // The offset of the section table.
+                uint64_t sectionTable;
+
+                // The size of the whole file.
+                uint64_t size;
+
+                // Unused.
+                uint64_t reserved;
+            };
+
+            /**
+             * An entry of the section table.
+             */
+            struct SnapshotSection
+            {
+                // The offset of the section from the start of the file.
+                uint64_t offset;
+
+                // The size of the section in bytes.
+                uint64_t size;
+            };
+
+            static const char SnapshotSignature[8] = { 'C', 'A', 'S', 'C', 'S', 'N', 'A', 'P' };
+            static const uint32_t SnapshotVersion = 1U;
+            static const uint32_t SnapshotByteOrder = 0x01020304U;
+
+            // Sections start on cache line boundaries, which is enough for any stored table.
+            static const size_t SnapshotAlignment = 64U;
+        }
+
+        /**
+         * Writes parsed tables to a snapshot file, one section per table.
+         * The file is written under a temporary name and moved into place when it's committed,
+         * so readers never see a partly written snapshot.
+         */
+        class SnapshotWriter
+        {
+        private:
+            // The path of the snapshot.
+            std::string path;
+
+            // The path the snapshot is written to until it's committed.
+            std::string temporary;
+
+            // The temporary file.
+            std::ofstream stream;
+
+            // The sections written so far.
+            std::vector<Impl::SnapshotSection> sections;
+
+            // The size of the file written so far.
+            uint64_t position = 0;
+
+            /**
+             * Writes bytes to the end of the file.
+             */
+            void write(const void *data, size_t size)
+            {
+                stream.write(static_cast<const char*>(data), size);
+
+                if (stream.fail())
+                {
+                    throw Exceptions::IOException("Couldn't write the snapshot.");
+                }
+
+                position += size;
+            }
+
+            /**
+             * Pads the file to the alignment of a section.
+             */
+            void align()
+            {
+                static const char zeros[Impl::SnapshotAlignment] = { };
+
+                write(zeros, size_t((Impl::SnapshotAlignment - position % Impl::SnapshotAlignment) % Impl::SnapshotAlignment));
+            }
+
+        public:
+            /**
+             * Constructor. Starts a snapshot.
+             */
+            SnapshotWriter(const std::string &path)
+                : path(path), temporary(path + "." + std::to_string(std::random_device()()) + ".tmp"),
+                  stream(temporary, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc)
+            {
+                if (!stream.is_open())
+                {
+                    throw Exceptions::IOException("Couldn't create the snapshot.");
+                }
+
+                Impl::SnapshotHeader header = { };
+                write(&header, sizeof(header));
+            }
+
+            /**
+             * Copy constructor (deleted).
+             */
+            SnapshotWriter(const SnapshotWriter &) = delete;
+
+            /**
+             * Copy operator (deleted).
+             */
+            SnapshotWriter &operator= (const SnapshotWriter &) = delete;
+
+            /**
+             * Destructor. Removes the snapshot if it wasn't committed.
+             */
+            virtual ~SnapshotWriter()
+            {
+                if (stream.is_open())
+                {
+                    stream.close();
+                    std::remove(temporary.c_str());
+                }
+            }
+
+            /**
+             * Adds a table as the next section.
+             */
+            template <typename T>
+            void add(Span<const T> elements)
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable tables can be stored.");
+
+                align();
+
+                sections.push_back({ position, uint64_t(elements.size() * sizeof(T)) });
+                write(elements.data(), elements.size() * sizeof(T));
+            }
+
+            /**
+             * Adds a single value as the next section.
+             */
+            template <typename T>
+            void add(const T &value)
+            {
+                add(Span<const T>(&value, 1));
+            }
+
+            /**
+             * Finishes the snapshot and moves it into place.
+             */
+            void commit(const Key &id)
+            {
+                align();
+
+                Impl::SnapshotHeader header = { };
+                std::memcpy(header.signature, Impl::SnapshotSignature, sizeof(header.signature));
+                header.version = Impl::SnapshotVersion;
+                header.byteOrder = Impl::SnapshotByteOrder;
+                header.id = id;
+                header.sectionCount = sections.size();
+                header.sectionTable = position;
+                header.size = position + sections.size() * sizeof(Impl::SnapshotSection);
+
+                write(sections.data(), sections.size() * sizeof(Impl::SnapshotSection));
+
+                stream.seekp(0);
+                stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+                stream.close();
+
+                if (stream.fail())
+                {
+                    std::remove(temporary.c_str());
+                    throw Exceptions::IOException("Couldn't write the snapshot.");
+                }
+
+#ifdef _MSC_VER
+                // Windows doesn't replace files when renaming.
+                std::remove(path.c_str());
+#endif
+
+                if (std::rename(temporary.c_str(), path.c_str()) != 0)
+                {
+                    std::remove(temporary.c_str());
+                    throw Exceptions::IOException("Couldn't move the snapshot into place.");
+                }
+            }
+        };
+
+        /**
+         * A mapped snapshot file. The tables are read in the order they were added and
+         * point straight into the mapping, which they keep alive.
+         */
+        class Snapshot
+        {
+        private:
+            // The mapped file.
+            std::shared_ptr<const MappedFile> file;
+
+            // The section table.
+            Span<const Impl::SnapshotSection> sections;
+
+            // The next section to read.
+            size_t next_ = 0;
+
+            /**
+             * Constructor.
+             */
+            Snapshot(std::shared_ptr<const MappedFile> file, Span<const Impl::SnapshotSection> sections)
+                : file(std::move(file)), sections(sections)
+            {
+            }
+
+        public:
+            /**
+             * Maps a snapshot and checks that it's complete and was made from the same data.
+             * Returns null if there's no usable snapshot at the path.
+             */
+            static std::shared_ptr<Snapshot> open(const std::string &path, const Key &id)
+            {
+                std::shared_ptr<const MappedFile> file;
+
+                try
+                {
+                    file = std::make_shared<MappedFile>(path);
+                }
+                catch (const Exceptions::CascException &)
+                {
+                    return nullptr;
+                }
+
+                if (file->size() < sizeof(Impl::SnapshotHeader))
+                {
+                    return nullptr;
+                }
+
+                auto &header = *reinterpret_cast<const Impl::SnapshotHeader*>(file->data());
+
+                if (std::memcmp(header.signature, Impl::SnapshotSignature, sizeof(header.signature)) != 0 ||
+                    header.version != Impl::SnapshotVersion ||
+                    header.byteOrder != Impl::SnapshotByteOrder ||
+                    header.id != id ||
+                    header.size != file->size() ||
+                    header.sectionTable % Impl::SnapshotAlignment != 0 ||
+                    header.sectionTable > header.size ||
+                    (header.size - header.sectionTable) / sizeof(Impl::SnapshotSection) != header.sectionCount)
+                {
+                    return nullptr;
+                }
+
+                Span<const Impl::SnapshotSection> sections(
+                    reinterpret_cast<const Impl::SnapshotSection*>(file->data() + header.sectionTable), size_t(header.sectionCount));
+
+                for (auto &section : sections)
+                {
+                    if (section.offset % Impl::SnapshotAlignment != 0 ||
+                        section.offset > header.sectionTable || section.size > header.sectionTable - section.offset)
+                    {
+                        return nullptr;
+                    }
+                }
+
+                return std::shared_ptr<Snapshot>(new Snapshot(std::move(file), sections));
+            }
+
+            /**
+             * Reads the next section as a table.
+             */
+            template <typename T>
+            SharedSpan<T> next()
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable tables can be stored.");
+
+                if (next_ >= sections.size() || sections[next_].size % sizeof(T) != 0)
+                {
+                    throw Exceptions::ParserException("The snapshot doesn't match the tables read from it.");
+                }
+
+                auto &section = sections[next_++];
+
+                return SharedSpan<T>(file, Span<const T>(
+                    reinterpret_cast<const T*>(file->data() + section.offset), size_t(section.size / sizeof(T))));
+            }
+
+            /**
+             * Reads the next section as a single value.
+             */
+            template <typename T>
+            T nextValue()
+            {
+                auto table = next<T>();
+
+                if (table.size() != 1)
+                {
+                    throw Exceptions::ParserException("The snapshot doesn't match the tables read from it.");
+                }
+
+                return table[0];
+            }
+        };
+    }
+}
\ No newline at end of file
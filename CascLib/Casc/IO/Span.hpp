@@ -0,0 +1,125 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <type_traits>
+
+namespace Casc
+{
+    namespace IO
+    {
+        /**
+         * A non-owning view of a contiguous range of elements.
+         */
+        template <typename T>
+        class Span
+        {
+        public:
+            typedef T value_type;
+            typedef T *iterator;
+
+        private:
+            // The first element.
+            T *data_ = nullptr;
+
+            // The number of elements.
+            size_t size_ = 0;
+
+        public:
+            /**
+             * Default constructor. Creates an empty span.
+             */
+            Span() { }
+
+            /**
+             * Constructor.
+             */
+            Span(T *data, size_t size)
+                : data_(data), size_(size)
+            {
+            }
+
+            /**
+             * Converting constructor (e.g. Span<char> to Span<const char>).
+             */
+            template <typename U, typename = typename std::enable_if<
+                std::is_convertible<U*, T*>::value>::type>
+            Span(const Span<U> &other)
+                : data_(other.data()), size_(other.size())
+            {
+            }
+
+            T *data() const noexcept
+            {
+                return data_;
+            }
+
+            size_t size() const noexcept
+            {
+                return size_;
+            }
+
+            bool empty() const noexcept
+            {
+                return size_ == 0;
+            }
+
+            iterator begin() const noexcept
+            {
+                return data_;
+            }
+
+            iterator end() const noexcept
+            {
+                return data_ + size_;
+            }
+
+            T &operator[](size_t index) const
+            {
+                return data_[index];
+            }
+
+            T &front() const
+            {
+                return data_[0];
+            }
+
+            T &back() const
+            {
+                return data_[size_ - 1];
+            }
+
+            /**
+             * Gets a view of a part of the span. The count is clamped to the available elements.
+             */
+            Span subspan(size_t offset, size_t count = SIZE_MAX) const
+            {
+                if (offset >= size_)
+                {
+                    return Span();
+                }
+
+                return Span(data_ + offset, count < size_ - offset ? count : size_ - offset);
+            }
+        };
+    }
+}
\ No newline at end of file
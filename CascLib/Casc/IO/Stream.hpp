@@ -58,6 +58,38 @@ namespace Casc
                 open(filename, offset);
             }
 
+            /**
+             * Constructor.
+             */
+            Stream(std::shared_ptr<File> file, size_t offset, size_t size = 0,
+                std::shared_ptr<ChunkCache> cache = nullptr, size_t bufferSize = 0,
+                VerificationMode verification = VerificationMode::None, AccessPattern access = AccessPattern::Normal) :
+                buf(reinterpret_cast<Buffer*>(this->rdbuf())),
+                std::istream(new Buffer())
+            {
+                buf->setCache(cache);
+                buf->setBufferSize(bufferSize);
+                buf->setVerification(verification);
+                buf->setAccessPattern(access);
+                open(file, offset, size);
+            }
+
+            /**
+             * Constructor.
+             */
+            Stream(std::shared_ptr<const MappedFile> file, size_t offset, size_t size = 0,
+                std::shared_ptr<ChunkCache> cache = nullptr, size_t bufferSize = 0,
+                VerificationMode verification = VerificationMode::None, AccessPattern access = AccessPattern::Normal) :
+                buf(reinterpret_cast<Buffer*>(this->rdbuf())),
+                std::istream(new Buffer())
+            {
+                buf->setCache(cache);
+                buf->setBufferSize(bufferSize);
+                buf->setVerification(verification);
+                buf->setAccessPattern(access);
+                open(file, offset, size);
+            }
+
             /**
              * Move constructor.
              */
@@ -89,6 +121,22 @@ namespace Casc
                 open(filename.c_str(), offset);
             }
 
+            /**
+             * Opens a file in an open data file.
+             */
+            void open(std::shared_ptr<File> file, size_t offset, size_t size = 0)
+            {
+                buf->open(file, offset, size);
+            }
+
+            /**
+             * Opens a file in a mapped data file.
+             */
+            void open(std::shared_ptr<const MappedFile> file, size_t offset, size_t size = 0)
+            {
+                buf->open(file, offset, size);
+            }
+
             /**
              * Closes the file.
              */
@@ -24,8 +24,12 @@
 #include <sstream>
 
 #include "../Common.hpp"
+#include "../ContainerOptions.hpp"
 
 #include "../Parsers/Binary/Reference.hpp"
+#include "ChunkCache.hpp"
+#include "FilePool.hpp"
+#include "MappedFile.hpp"
 #include "Stream.hpp"
 
 namespace Casc
@@ -40,6 +44,36 @@ namespace Casc
             */
             std::string basePath;
 
+            /**
+            * Map the data files instead of opening a stream per file.
+            */
+            bool mapped;
+
+            /**
+            * The open data files.
+            */
+            mutable FilePool files;
+
+            /**
+            * The decoded chunks shared by all streams.
+            */
+            std::shared_ptr<ChunkCache> cache;
+
+            /**
+            * The refill size of the streams.
+            */
+            size_t bufferSize;
+
+            /**
+            * When the streams check checksums.
+            */
+            VerificationMode verification;
+
+            /**
+            * How the streams read the data files unless told otherwise.
+            */
+            AccessPattern access;
+
             /**
             * Create path to a file.
             */
@@ -85,6 +119,20 @@ namespace Casc
                 return out.str();
             }
 
+            /**
+            * The name of an index file.
+            */
+            static std::string indexName(uint32_t bucket, uint32_t version)
+            {
+                std::stringstream ss;
+
+                ss << std::setw(2) << std::setfill('0') << std::hex << bucket;
+                ss << std::setw(8) << std::setfill('0') << std::hex << version;
+                ss << ".idx";
+
+                return ss.str();
+            }
+
             /**
             * Create the stream for a path.
             */
@@ -109,8 +157,13 @@ namespace Casc
             /**
             * Constructor.
             */
-            StreamAllocator(const std::string basePath)
-                : basePath(basePath)
+            StreamAllocator(const std::string basePath, const ContainerOptions &options = ContainerOptions())
+                : basePath(basePath), mapped(options.mapped),
+                  files(basePath + PathSeparator + "data", options.maxOpenFiles),
+                  cache(options.chunkCacheSize > 0 ? std::make_shared<ChunkCache>(options.chunkCacheSize) : nullptr),
+                  bufferSize(options.bufferSize),
+                  verification(options.verification),
+                  access(options.access)
             {
 
             }
@@ -147,14 +200,22 @@ namespace Casc
                     typename std::conditional<Writeable, std::ofstream, std::ifstream >::type>::type >
             std::shared_ptr<TStream> index(uint32_t bucket, uint32_t version)
             {
-                std::stringstream ss;
+                return allocate<Writeable, TStream>(
+                    createPath(DataFolders::Data, indexName(bucket, version)));
+            }
 
-                ss << std::setw(2) << std::setfill('0') << std::hex << bucket;
-                ss << std::setw(8) << std::setfill('0') << std::hex << version;
-                ss << ".idx";
+            /**
+            * Maps an index, so it can be parsed in place.
+            */
+            std::shared_ptr<const MappedFile> mappedIndex(uint32_t bucket, uint32_t version) const
+            {
+                auto mapping = std::make_shared<MappedFile>(
+                    createPath(DataFolders::Data, indexName(bucket, version)));
 
-                return allocate<Writeable, TStream>(
-                    createPath(DataFolders::Data, ss.str()));
+                // The whole index is parsed front to back right away.
+                mapping->advise(0, mapping->size(), AccessPattern::Sequential);
+
+                return mapping;
             }
 
             /**
@@ -173,14 +234,28 @@ namespace Casc
                     createPath(DataFolders::Data, ss.str()));
             }
 
+            /**
+            * How the streams read the data files unless told otherwise.
+            */
+            AccessPattern accessPattern() const
+            {
+                return access;
+            }
+
             std::shared_ptr<Stream> data(const Parsers::Binary::Reference &ref) const
             {
-                std::stringstream ss;
+                return data(ref, access);
+            }
 
-                ss << "data." << std::setw(3) << std::setfill('0') << ref.file();
+            std::shared_ptr<Stream> data(const Parsers::Binary::Reference &ref, AccessPattern pattern) const
+            {
+                if (mapped)
+                {
+                    return std::make_shared<Stream>(
+                        files.mapping(static_cast<uint32_t>(ref.file()), ref.offset() + ref.size()), ref.offset(), ref.size(), cache, bufferSize, verification, pattern);
+                }
 
-                return std::make_shared<Stream>(
-                    createPath(DataFolders::Data, ss.str()), ref.offset());
+                return std::make_shared<Stream>(files.file(static_cast<uint32_t>(ref.file())), ref.offset(), ref.size(), cache, bufferSize, verification, pattern);
             }
         };
     }
@@ -0,0 +1,42 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+namespace Casc
+{
+    namespace IO
+    {
+        /**
+        * When the checksums of a file are checked.
+        */
+        enum class VerificationMode
+        {
+            // Checksums aren't checked.
+            None,
+
+            // The header and block table are checked when the file is opened,
+            // and each chunk when it's first read.
+            Lazy,
+
+            // The header, the block table and every chunk are checked when the file is opened.
+            Eager
+        };
+    }
+}
\ No newline at end of file
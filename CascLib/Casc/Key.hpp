@@ -0,0 +1,307 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CASC_KEY_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Exceptions/ParserException.hpp"
+#include "Hex.hpp"
+#include "StringView.hpp"
+
+namespace Casc
+{
+    /**
+     * A fixed-size binary key, such as an MD5 content hash or an encoding key.
+     * Trivially copyable; it's only rendered as hex when asked.
+     */
+    template <size_t Size>
+    class BasicKey
+    {
+    public:
+        typedef uint8_t value_type;
+        typedef const uint8_t *const_iterator;
+
+    private:
+        // The bytes of the key. Shorter input is padded with zeros.
+        std::array<uint8_t, Size> bytes;
+
+        /**
+         * Parses a hex digit. Returns 16 if it isn't one.
+         */
+        static uint8_t digit(char c)
+        {
+            if (c >= '0' && c <= '9') return uint8_t(c - '0');
+            if (c >= 'a' && c <= 'f') return uint8_t(c - 'a' + 10);
+            if (c >= 'A' && c <= 'F') return uint8_t(c - 'A' + 10);
+
+            return 16;
+        }
+
+    public:
+        /**
+         * Default constructor. Creates a key of zeros.
+         */
+        BasicKey()
+            : bytes()
+        {
+        }
+
+        /**
+         * Constructor. Copies up to Size bytes from a range.
+         */
+        template <typename InputIt>
+        BasicKey(InputIt first, InputIt last)
+            : bytes()
+        {
+            for (size_t i = 0; i < Size && first != last; ++i, ++first)
+            {
+                bytes[i] = uint8_t(*first);
+            }
+        }
+
+        /**
+         * Constructor. Parses a hex string of exactly 2 * Size digits.
+         * Throws a ParserException for anything else; use prefix() to take the start of a longer key.
+         */
+        explicit BasicKey(StringView hex)
+            : bytes()
+        {
+            if (hex.size() != Size * 2)
+            {
+                throw Exceptions::ParserException("A key has to be " + std::to_string(Size * 2) + " hex digits: " + hex.string());
+            }
+
+            for (size_t i = 0; i < Size; ++i)
+            {
+                auto high = digit(hex[i * 2]);
+                auto low = digit(hex[i * 2 + 1]);
+
+                if (high > 15 || low > 15)
+                {
+                    throw Exceptions::ParserException("A key has to be " + std::to_string(Size * 2) + " hex digits: " + hex.string());
+                }
+
+                bytes[i] = uint8_t(high << 4 | low);
+            }
+        }
+
+        /**
+         * Constructor. Parses a hex string of exactly 2 * Size digits.
+         */
+        explicit BasicKey(const std::string &hex)
+            : BasicKey(StringView(hex))
+        {
+        }
+
+        /**
+         * Constructor. Parses a hex string of exactly 2 * Size digits.
+         */
+        explicit BasicKey(const char *hex)
+            : BasicKey(StringView(hex))
+        {
+        }
+
+        /**
+         * Constructor. Copies the bytes of a Hex.
+         */
+        BasicKey(const Hex &hex)
+            : BasicKey(hex.begin(), hex.end())
+        {
+        }
+
+        /**
+         * Parses the first 2 * Size digits of a hex string, e.g. the index key of an encoding key.
+         * Throws a ParserException if the string is shorter or they aren't hex digits.
+         */
+        static BasicKey prefix(StringView hex)
+        {
+            if (hex.size() < Size * 2)
+            {
+                throw Exceptions::ParserException("A key has to be at least " + std::to_string(Size * 2) + " hex digits: " + hex.string());
+            }
+
+            return BasicKey(hex.substr(0, Size * 2));
+        }
+
+        /**
+         * Constructor. Truncates or pads a key of another size, e.g. an encoding key to an index key.
+         */
+        template <size_t Other>
+        explicit BasicKey(const BasicKey<Other> &key)
+            : BasicKey(key.begin(), key.end())
+        {
+        }
+
+        const uint8_t *data() const noexcept
+        {
+            return bytes.data();
+        }
+
+        uint8_t *data() noexcept
+        {
+            return bytes.data();
+        }
+
+        static constexpr size_t size() noexcept
+        {
+            return Size;
+        }
+
+        const_iterator begin() const noexcept
+        {
+            return bytes.data();
+        }
+
+        const_iterator end() const noexcept
+        {
+            return bytes.data() + Size;
+        }
+
+        uint8_t operator[](size_t index) const
+        {
+            return bytes[index];
+        }
+
+        /**
+         * Renders the key as lowercase hex.
+         */
+        std::string string() const
+        {
+            static const char digits[] = "0123456789abcdef";
+
+            std::string out(Size * 2, '0');
+
+            for (size_t i = 0; i < Size; ++i)
+            {
+                out[i * 2] = digits[bytes[i] >> 4];
+                out[i * 2 + 1] = digits[bytes[i] & 0xF];
+            }
+
+            return out;
+        }
+
+        /**
+         * Compares two keys byte by byte. Returns a negative, zero or positive value like memcmp.
+         */
+        static int compare(const BasicKey &a, const BasicKey &b)
+        {
+            return std::memcmp(a.data(), b.data(), Size);
+        }
+
+        bool operator ==(const BasicKey &b) const
+        {
+            return compare(*this, b) == 0;
+        }
+
+        bool operator !=(const BasicKey &b) const
+        {
+            return !(*this == b);
+        }
+
+        bool operator <(const BasicKey &b) const
+        {
+            return compare(*this, b) < 0;
+        }
+
+        bool operator >(const BasicKey &b) const
+        {
+            return compare(*this, b) > 0;
+        }
+
+        bool operator <=(const BasicKey &b) const
+        {
+            return compare(*this, b) <= 0;
+        }
+
+        bool operator >=(const BasicKey &b) const
+        {
+            return compare(*this, b) >= 0;
+        }
+    };
+
+#ifdef CASC_KEY_SSE2
+    /**
+     * Compares two 16 byte keys with SSE2: one compare finds the first differing byte.
+     */
+    template <>
+    inline int BasicKey<16>::compare(const BasicKey &a, const BasicKey &b)
+    {
+        auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data()));
+        auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data()));
+        auto mask = unsigned(~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) & 0xFFFFU;
+
+        if (mask == 0)
+        {
+            return 0;
+        }
+
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+#else
+        auto index = __builtin_ctz(mask);
+#endif
+
+        return int(a.bytes[index]) - int(b.bytes[index]);
+    }
+#endif
+
+    /**
+     * A content hash or encoding key.
+     */
+    typedef BasicKey<16> Key;
+
+    /**
+     * An encoding key truncated to the size used by the .idx files.
+     */
+    typedef BasicKey<9> IndexKey;
+}
+
+namespace std
+{
+    template <size_t Size>
+    struct hash<Casc::BasicKey<Size>>
+    {
+        size_t operator()(const Casc::BasicKey<Size> &key) const
+        {
+            // The keys are MD5 hashes, so their first bytes are already well mixed.
+            size_t value = 0;
+            std::memcpy(&value, key.data(), std::min(sizeof(value), Size));
+
+            return value;
+        }
+    };
+}
+
+#undef CASC_KEY_SSE2
\ No newline at end of file
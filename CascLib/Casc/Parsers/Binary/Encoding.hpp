@@ -19,9 +19,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <fstream>
 #include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 
@@ -29,10 +35,16 @@
 
 #include "../../Common.hpp"
 #include "../../Exceptions.hpp"
+#include "../../Key.hpp"
+
+#include "../../Crypto/MD5.hpp"
+#include "../../IO/SharedSpan.hpp"
+#include "../../IO/Snapshot.hpp"
 
 #include "../../Parsers/Binary/Reference.hpp"
 #include "../../IO/StreamAllocator.hpp"
 #include "../../IO/Endian.hpp"
+#include "../../IO/Span.hpp"
 
 namespace Casc
 {
@@ -46,122 +58,268 @@ namespace Casc
             class Encoding
             {
             public:
+                // The largest key the tables can hold.
+                static const size_t MaxKeySize = Key::size();
+
                 struct FileInfo
                 {
-                    Hex hash;
+                    Key hash;
                     size_t size;
-                    std::vector<Hex> keys;
+                    std::vector<Key> keys;
                 };
 
                 struct EncodedFileInfo
                 {
-                    Hex key;
+                    Key key;
                     size_t size;
                     std::string params;
                 };
 
                 /**
-                 * Find the file info for a file hash.
+                 * A record of the content hash table, viewed in place. Valid as long as the encoding file.
                  */
-                FileInfo findFileInfo(Hex hash) const
+                class FileInfoView
                 {
-                    auto index = -1;
-                    Hex checksum;
+                    // The start of the record.
+                    const uint8_t *record;
+
+                    // The size of the content hash.
+                    size_t hashSize;
 
-                    for (auto i = 0U; i < headersA.size(); ++i)
+                    // The size of the encoding keys.
+                    size_t keySize;
+
+                public:
+                    FileInfoView(const uint8_t *record, size_t hashSize, size_t keySize)
+                        : record(record), hashSize(hashSize), keySize(keySize)
                     {
-                        if (headersA[i].first <= hash)
-                        {
-                            index = headersA.size() - 1 - i;
-                            checksum = headersA[i].second;
-                            break;
-                        }
                     }
 
-                    if (index == -1)
+                    /**
+                     * The number of encoding keys of the file.
+                     */
+                    size_t keyCount() const
+                    {
+                        return record[0];
+                    }
+
+                    /**
+                     * The size of the file content.
+                     */
+                    size_t size() const
+                    {
+                        return size_t(uint64_t(record[1]) << 32 | IO::Endian::read<IO::EndianType::Big, uint32_t>(record + 2));
+                    }
+
+                    /**
+                     * The content hash.
+                     */
+                    Key hash() const
+                    {
+                        return Key(record + 6, record + 6 + hashSize);
+                    }
+
+                    /**
+                     * An encoding key of the file.
+                     */
+                    Key key(size_t index) const
                     {
-                        throw Exceptions::HashDoesNotExistException(hash.string());
+                        auto key = record + 6 + hashSize + keySize * index;
+
+                        return Key(key, key + keySize);
                     }
 
-                    auto files = parseEntry(index, checksum);
+                    /**
+                     * The size of the record.
+                     */
+                    size_t extent() const
+                    {
+                        return 6 + hashSize + keySize * keyCount();
+                    }
+                };
+
+                /**
+                 * A record of the encoding key table, viewed in place. Valid as long as the encoding file.
+                 */
+                class EncodedFileInfoView
+                {
+                    // The start of the record.
+                    const uint8_t *record;
+
+                    // The size of the encoding key.
+                    size_t keySize;
 
-                    for (auto it = files.begin(); it != files.end(); ++it)
+                    // The encoding profiles.
+                    const std::vector<std::string> *profiles;
+
+                public:
+                    EncodedFileInfoView(const uint8_t *record, size_t keySize, const std::vector<std::string> *profiles)
+                        : record(record), keySize(keySize), profiles(profiles)
                     {
-                        if (it->hash == hash)
+                    }
+
+                    /**
+                     * The encoding key.
+                     */
+                    Key key() const
+                    {
+                        return Key(record, record + keySize);
+                    }
+
+                    /**
+                     * The size of the encoded file.
+                     */
+                    size_t size() const
+                    {
+                        return size_t(uint64_t(record[keySize + 4]) << 32 |
+                            IO::Endian::read<IO::EndianType::Big, uint32_t>(record + keySize + 5));
+                    }
+
+                    /**
+                     * The encoding profile, or an empty string if the file has none.
+                     */
+                    const std::string &params() const
+                    {
+                        static const std::string none;
+
+                        auto index = IO::Endian::read<IO::EndianType::Big, uint32_t>(record + keySize);
+
+                        return index < profiles->size() ? (*profiles)[index] : none;
+                    }
+                };
+
+                /**
+                 * Finds the record of a content hash without copying it.
+                 */
+                FileInfoView viewFileInfo(const Key &hash) const
+                {
+                    auto index = tableA.find(hash);
+
+                    if (index < tableA.count())
+                    {
+                        auto page = tableA.page(index);
+                        auto end = page + tableA.pageSize;
+
+                        for (auto it = page; it + 6 + hashSizeA <= end;)
                         {
-                            return *it;
+                            FileInfoView info(it, hashSizeA, hashSizeB);
+
+                            if (info.keyCount() == 0 || it + info.extent() > end)
+                            {
+                                break;
+                            }
+
+                            auto order = std::memcmp(it + 6, hash.data(), hashSizeA);
+
+                            if (order == 0)
+                            {
+                                return info;
+                            }
+
+                            // The records are sorted, so the hash isn't in the page once they pass it.
+                            if (order > 0)
+                            {
+                                break;
+                            }
+
+                            it += info.extent();
                         }
                     }
-                    
+
                     throw Exceptions::HashDoesNotExistException(hash.string());
                 }
 
                 /**
-                 * Find the encoding info for a file key.
+                 * Finds the record of an encoding key without copying it.
                  */
-                EncodedFileInfo findEncodedFileInfo(Hex key) const
+                EncodedFileInfoView viewEncodedFileInfo(const Key &key) const
                 {
-                    auto index = -1;
-                    Hex checksum;
+                    auto index = tableB.find(key);
 
-                    for (auto i = 0U; i < headersB.size(); ++i)
+                    if (index < tableB.count())
                     {
-                        if (headersB[i].first <= key)
+                        auto page = tableB.page(index);
+                        auto recordSize = hashSizeB + 9;
+                        auto count = tableB.pageSize / recordSize;
+
+                        // Pages are padded with empty records, which sort after all the others.
+                        auto less = [&](size_t i)
                         {
-                            index = headersB.size() - 1 - i;
-                            checksum = headersB[i].second;
-                            break;
+                            auto record = page + recordSize * i;
+
+                            return !isEmpty(record, hashSizeB) && std::memcmp(record, key.data(), hashSizeB) < 0;
+                        };
+
+                        size_t base = 0;
+
+                        while (count > 1)
+                        {
+                            auto half = count / 2;
+                            base = less(base + half) ? base + half : base;
+                            count -= half;
                         }
-                    }
 
-                    if (index == -1)
-                    {
-                        throw Exceptions::KeyDoesNotExistException(key.string());
-                    }
+                        if (count > 0 && less(base))
+                        {
+                            ++base;
+                        }
 
-                    auto files = parseEncodedEntry(index, checksum);
+                        auto record = page + recordSize * base;
 
-                    for (auto it = files.begin(); it != files.end(); ++it)
-                    {
-                        if (it->key == key)
+                        if (base < tableB.pageSize / recordSize && std::memcmp(record, key.data(), hashSizeB) == 0)
                         {
-                            return *it;
+                            return EncodedFileInfoView(record, hashSizeB, &profiles);
                         }
                     }
 
                     throw Exceptions::KeyDoesNotExistException(key.string());
                 }
 
+                /**
+                 * Find the file info for a file hash.
+                 */
+                FileInfo findFileInfo(const Key &hash) const
+                {
+                    return toFileInfo(viewFileInfo(hash));
+                }
+
+                /**
+                 * Find the encoding info for a file key.
+                 */
+                EncodedFileInfo findEncodedFileInfo(const Key &key) const
+                {
+                    return toEncodedFileInfo(viewEncodedFileInfo(key));
+                }
+
                 /**
                  * Get file info for a range of files.
                  */
                 std::vector<FileInfo> listFileInfo(uint32_t offset, uint32_t count) const
                 {
                     std::vector<FileInfo> list;
+                    size_t skipped = 0;
 
-                    while (list.size() < count)
+                    for (size_t index = 0; index < tableA.count() && list.size() < count; ++index)
                     {
-                        auto remaining = count - list.size();
+                        auto page = tableA.page(index);
+                        auto end = page + tableA.pageSize;
 
-                        auto index = -1;
-                        Hex checksum;
-
-                        if (offset < headersA.size())
-                        {
-                            index = headersA.size() - 1 - offset;
-                            checksum = headersA[offset].second;
-                        }
-                        else
+                        for (auto it = page; it + 6 + hashSizeA <= end && list.size() < count;)
                         {
-                            break;
-                        }
+                            FileInfoView info(it, hashSizeA, hashSizeB);
 
-                        auto files = parseEntry(index, checksum);
-                        auto n = remaining < files.size() ? remaining : files.size();
+                            if (info.keyCount() == 0 || it + info.extent() > end)
+                            {
+                                break;
+                            }
 
-                        files.insert(list.end(), files.begin(), files.begin() + n);
+                            if (skipped++ >= offset)
+                            {
+                                list.push_back(toFileInfo(info));
+                            }
 
-                        offset += n;
+                            it += info.extent();
+                        }
                     }
 
                     return list;
@@ -173,30 +331,25 @@ namespace Casc
                 std::vector<EncodedFileInfo> listEncodedFileInfo(uint32_t offset, uint32_t count) const
                 {
                     std::vector<EncodedFileInfo> list;
+                    size_t skipped = 0;
+                    auto recordSize = hashSizeB + 9;
 
-                    while (list.size() < count)
+                    for (size_t index = 0; index < tableB.count() && list.size() < count; ++index)
                     {
-                        auto remaining = list.size() - count;
-
-                        auto index = -1;
-                        Hex checksum;
+                        auto page = tableB.page(index);
 
-                        if (offset < headersB.size())
+                        for (size_t i = 0; i + recordSize <= tableB.pageSize && list.size() < count; i += recordSize)
                         {
-                            index = headersB.size() - 1 - offset;
-                            checksum = headersB[offset].second;
+                            if (isEmpty(page + i, hashSizeB))
+                            {
+                                break;
+                            }
+
+                            if (skipped++ >= offset)
+                            {
+                                list.push_back(toEncodedFileInfo(EncodedFileInfoView(page + i, hashSizeB, &profiles)));
+                            }
                         }
-                        else
-                        {
-                            break;
-                        }
-
-                        auto files = parseEncodedEntry(index, headersB[index].second);
-                        auto count = remaining < files.size() ? remaining : files.size();
-
-                        files.insert(list.end(), files.begin(), files.begin() + count);
-
-                        offset += count;
                     }
 
                     return list;
@@ -209,220 +362,288 @@ namespace Casc
                 // The header size of an encoding file.
                 static const unsigned int HeaderSize = 22U;
 
-                // The size of each chunk body (second block for each table).
-                static const unsigned int EntrySize = 4096U;
+                /**
+                 * A table of sorted pages. The first key of each page is kept in a flat array for binary search,
+                 * and each page is checked against its checksum the first time it's used.
+                 */
+                struct Table
+                {
+                    // The size of each page.
+                    size_t pageSize = 0;
 
-                std::vector<std::pair<Hex, Hex>> headersA;
-                std::vector<char> tableA;
-                size_t hashSizeA;
+                    // The first key of each page, padded with zeros.
+                    IO::SharedSpan<Key> firstKeys;
 
-                std::vector<std::pair<Hex, Hex>> headersB;
-                std::vector<char> tableB;
-                size_t hashSizeB;
+                    // The MD5 checksum of each page.
+                    IO::SharedSpan<Key> checksums;
 
-                // The encoding profiles
-                std::vector<std::string> profiles;
+                    // The pages.
+                    IO::SharedSpan<uint8_t> pages;
 
-                /**
-                * Reads data from a stream and puts it in a struct.
-                */
-                template <IO::EndianType Endian = IO::EndianType::Little, typename T>
-                const T &read(std::shared_ptr<std::istream> stream, T &value) const
-                {
-                    char b[sizeof(T)];
-                    stream->read(b, sizeof(T));
+                    // One bit per page, set once the page has been checked.
+                    std::unique_ptr<std::atomic<uint64_t>[]> verified;
 
-                    return value = IO::Endian::read<Endian, T>(b);
-                }
+                    // One bit per page, set while a thread checks the page.
+                    std::unique_ptr<std::atomic<uint64_t>[]> claimed;
 
-                /**
-                 * Parse an entry in the table.
-                 */
-                std::vector<FileInfo> parseEntry(uint32_t index, Hex checksum) const
-                {
-                    std::vector<FileInfo> files;
+                    /**
+                     * The number of pages.
+                     */
+                    size_t count() const
+                    {
+                        return firstKeys.size();
+                    }
 
-                    auto begin = tableA.begin() + EntrySize * index;
-                    auto end = begin + EntrySize;
+                    /**
+                     * Marks every page as unchecked.
+                     */
+                    void resetVerified()
+                    {
+                        verified.reset(new std::atomic<uint64_t>[(count() + 63) / 64]);
+                        claimed.reset(new std::atomic<uint64_t>[(count() + 63) / 64]);
 
-                    Hex actual(md5(begin, end));
+                        for (size_t i = 0; i < (count() + 63) / 64; ++i)
+                        {
+                            verified[i] = 0;
+                            claimed[i] = 0;
+                        }
+                    }
 
-                    if (actual != checksum)
+                    /**
+                     * Finds the page that would hold a key. Returns count() if no page can hold it.
+                     */
+                    size_t find(const Key &key) const
                     {
-                        throw Exceptions::InvalidHashException(Crypto::lookup3(checksum, 0), Crypto::lookup3(actual, 0), "");
+                        auto it = std::upper_bound(firstKeys.begin(), firstKeys.end(), key);
+
+                        return it == firstKeys.begin() ? count() : size_t(it - firstKeys.begin()) - 1;
                     }
 
-                    for (auto it = begin; it < end;)
+                    /**
+                     * Gets a page, checking it first if it hasn't been checked yet.
+                     * Only the thread that claims a page hashes it; the others wait for the result.
+                     */
+                    const uint8_t *page(size_t index) const
                     {
-                        auto keyCount =
-                            IO::Endian::read<IO::EndianType::Little, uint16_t>(it);
-                        it += sizeof(keyCount);
+                        auto data = pages.data() + pageSize * index;
+                        auto &word = verified[index / 64];
+                        auto &claim = claimed[index / 64];
+                        auto bit = uint64_t(1) << (index % 64);
 
-                        if (keyCount == 0)
-                            break;
+                        while ((word.load(std::memory_order_acquire) & bit) == 0)
+                        {
+                            if ((claim.fetch_or(bit, std::memory_order_acq_rel) & bit) != 0)
+                            {
+                                std::this_thread::yield();
+                                continue;
+                            }
 
-                        auto fileSize =
-                            IO::Endian::read<IO::EndianType::Big, uint32_t>(it);
-                        it += sizeof(fileSize);
+                            auto digest = Crypto::MD5(data, data + pageSize).digest();
+                            Key actual(digest.begin(), digest.end());
 
-                        auto checksumIt = it;
-                        it += hashSizeA;
+                            if (actual != checksums[index])
+                            {
+                                // Released so that every later use of the page fails the same way.
+                                claim.fetch_and(~bit, std::memory_order_release);
 
-                        std::vector<Hex> keys;
+                                throw Exceptions::InvalidHashException(
+                                    Crypto::lookup3(checksums[index], 0), Crypto::lookup3(actual, 0), "");
+                            }
 
-                        for (auto i = 0U; i < keyCount; ++i)
-                        {
-                            keys.emplace_back(it, it + hashSizeA);
-                            it += hashSizeA;
+                            word.fetch_or(bit, std::memory_order_release);
                         }
 
-                        files.emplace_back(FileInfo{ { checksumIt, checksumIt + hashSizeA }, fileSize, keys });
+                        return data;
                     }
+                };
 
-                    return files;
-                }
+                /**
+                 * The key and page sizes, as stored in a snapshot.
+                 */
+                struct Layout
+                {
+                    uint64_t hashSizeA;
+                    uint64_t hashSizeB;
+                    uint64_t pageSizeA;
+                    uint64_t pageSizeB;
+                };
+
+                Table tableA;
+                size_t hashSizeA;
+
+                Table tableB;
+                size_t hashSizeB;
+
+                // The encoding profiles
+                std::vector<std::string> profiles;
 
                 /**
-                 * Parse an entry in the table.
+                 * Checks if a record is padding.
                  */
-                std::vector<EncodedFileInfo> parseEncodedEntry(uint32_t index, Hex checksum) const
+                static bool isEmpty(const uint8_t *key, size_t size)
                 {
-                    std::vector<EncodedFileInfo> files;
+                    static const Key zero;
 
-                    auto begin = tableB.begin() + EntrySize * index;
-                    auto end = begin + EntrySize;
+                    return std::memcmp(key, zero.data(), size) == 0;
+                }
 
-                    Hex actual(md5(begin, end));
+                /**
+                 * Copies a record of the content hash table.
+                 */
+                static FileInfo toFileInfo(const FileInfoView &view)
+                {
+                    std::vector<Key> keys;
 
-                    if (actual != checksum)
+                    for (size_t i = 0; i < view.keyCount(); ++i)
                     {
-                        throw Exceptions::InvalidHashException(Crypto::lookup3(checksum, 0), Crypto::lookup3(actual, 0), "");
+                        keys.push_back(view.key(i));
                     }
 
-                    for (auto it = begin; it < end;)
-                    {
-                        auto checksumIt = it;
-                        it += hashSizeB;
-
-                        auto profileIndex =
-                            IO::Endian::read<IO::EndianType::Big, int32_t>(it);
-                        it += sizeof(profileIndex);
-
-                        ++it;
+                    return FileInfo{ view.hash(), view.size(), keys };
+                }
 
-                        auto fileSize =
-                            IO::Endian::read<IO::EndianType::Big, uint32_t>(it);
-                        it += sizeof(fileSize);
+                /**
+                 * Copies a record of the encoding key table.
+                 */
+                static EncodedFileInfo toEncodedFileInfo(const EncodedFileInfoView &view)
+                {
+                    return EncodedFileInfo{ view.key(), view.size(), view.params() };
+                }
 
-                        auto &profile = profiles[profileIndex];
-                        
-                        if (profileIndex >= 0)
-                        {
-                            files.emplace_back(EncodedFileInfo{ { checksumIt, checksumIt + hashSizeB }, fileSize, profile });
-                        }
-                        else
-                        {
-                            files.emplace_back(EncodedFileInfo{ { checksumIt, checksumIt + hashSizeB }, fileSize, "" });
-                        }
+                /**
+                 * Takes the next bytes of a decoded file, checking that they're inside it.
+                 */
+                static const uint8_t *take(IO::Span<const uint8_t> file, size_t &position, uint64_t size)
+                {
+                    if (file.size() - position < size)
+                    {
+                        throw Exceptions::ParserException("The encoding file is truncated.");
                     }
 
-                    return files;
+                    auto field = file.data() + position;
+                    position += size_t(size);
+
+                    return field;
                 }
 
                 /**
-                * Parse an encoding file.
-                */
-                void parse(std::shared_ptr<std::istream> stream)
+                 * Reads the page headers of a table, and views its pages in the decoded file.
+                 */
+                static void readTable(const std::shared_ptr<const std::vector<uint8_t>> &owner, size_t &position,
+                    Table &table, size_t keySize, uint32_t count)
                 {
-                    uint16_t signature;
-                    read<IO::EndianType::Little>(stream, signature);
+                    IO::Span<const uint8_t> file(owner->data(), owner->size());
 
-                    if (signature != Signature)
+                    auto headers = take(file, position, uint64_t(count) * (keySize + Key::size()));
+
+                    std::vector<Key> firstKeys;
+                    std::vector<Key> checksums;
+                    firstKeys.reserve(count);
+                    checksums.reserve(count);
+
+                    for (auto it = headers; it != file.data() + position; it += keySize + Key::size())
                     {
-                        throw Exceptions::InvalidSignatureException(signature, 0x4E45);
+                        firstKeys.emplace_back(it, it + keySize);
+                        checksums.emplace_back(it + keySize, it + keySize + Key::size());
                     }
 
-                    // Header
+                    auto pages = take(file, position, uint64_t(table.pageSize) * count);
 
-                    stream->seekg(1, std::ios_base::cur); // Skip unknown
+                    table.firstKeys = std::move(firstKeys);
+                    table.checksums = std::move(checksums);
+                    table.pages = IO::SharedSpan<uint8_t>(owner, IO::Span<const uint8_t>(pages, table.pageSize * count));
+                    table.resetVerified();
+                }
 
-                    uint8_t hashSizeA;
-                    this->hashSizeA = read<IO::EndianType::Little, uint8_t>(stream, hashSizeA);
+                /**
+                 * Reads a table from a snapshot.
+                 */
+                static void loadTable(IO::Snapshot &snapshot, Table &table, size_t pageSize)
+                {
+                    table.pageSize = pageSize;
+                    table.firstKeys = snapshot.next<Key>();
+                    table.checksums = snapshot.next<Key>();
+                    table.pages = snapshot.next<uint8_t>();
 
-                    uint8_t hashSizeB;
-                    this->hashSizeB = read<IO::EndianType::Little, uint8_t>(stream, hashSizeB);
+                    if (table.checksums.size() != table.count() || table.pages.size() != table.pageSize * table.count())
+                    {
+                        throw Exceptions::ParserException("The snapshot doesn't match the tables read from it.");
+                    }
 
-                    stream->seekg(4, std::ios_base::cur); // Skip flags
+                    table.resetVerified();
+                }
 
-                    uint32_t tableSizeA;
-                    read<IO::EndianType::Big>(stream, tableSizeA);
+                /**
+                 * Writes a table to a snapshot.
+                 */
+                static void saveTable(IO::SnapshotWriter &writer, const Table &table)
+                {
+                    writer.add(table.firstKeys.span());
+                    writer.add(table.checksums.span());
+                    writer.add(table.pages.span());
+                }
 
-                    uint32_t tableSizeB;
-                    read<IO::EndianType::Big>(stream, tableSizeB);
+                /**
+                 * Parses an encoding file decoded into memory. The pages are viewed in place, not copied.
+                 */
+                void parse(const std::shared_ptr<const std::vector<uint8_t>> &owner)
+                {
+                    IO::Span<const uint8_t> file(owner->data(), owner->size());
+                    size_t position = 0;
 
-                    stream->seekg(1, std::ios_base::cur); // Skip unknown
+                    // Header
 
-                    // Encoding profiles for table B
+                    auto header = take(file, position, HeaderSize);
 
-                    uint32_t stringTableSize;
-                    read<IO::EndianType::Big>(stream, stringTableSize);
+                    auto signature = IO::Endian::read<IO::EndianType::Little, uint16_t>(header);
 
-                    int ij = 0;
-                    while (stream->tellg() < (HeaderSize + stringTableSize - 1))
+                    if (signature != Signature)
                     {
-                        std::string profile;
-                        std::getline(*stream, profile, '\0');
-
-                        if (stream->fail())
-                        {
-                            throw Exceptions::IOException("Stream faulted after getline()");
-                        }
-
-                        profiles.emplace_back(profile);
-                        ij++;
+                        throw Exceptions::InvalidSignatureException(signature, 0x4E45);
                     }
 
-                    // Table A
-                    for (auto i = 0U; i < tableSizeA; ++i)
+                    // The version at offset 2 isn't used.
+                    hashSizeA = header[3];
+                    hashSizeB = header[4];
+
+                    if (hashSizeA > MaxKeySize || hashSizeB > MaxKeySize)
                     {
-                        std::vector<char> hash(hashSizeA);
-                        std::vector<char> checksum(hashSizeA);
+                        throw Exceptions::ParserException("Unsupported key size.");
+                    }
 
-                        stream->read(hash.data(), hashSizeA);
-                        stream->read(checksum.data(), hashSizeA);
+                    // The page sizes are in kilobytes.
+                    tableA.pageSize = IO::Endian::read<IO::EndianType::Big, uint16_t>(header + 5) * 1024U;
+                    tableB.pageSize = IO::Endian::read<IO::EndianType::Big, uint16_t>(header + 7) * 1024U;
 
-                        headersA.emplace_back(std::make_pair(hash, checksum));
-                    }
+                    auto tableSizeA = IO::Endian::read<IO::EndianType::Big, uint32_t>(header + 9);
+                    auto tableSizeB = IO::Endian::read<IO::EndianType::Big, uint32_t>(header + 13);
 
-                    std::reverse(headersA.begin(), headersA.end());
+                    // The byte at offset 17 is unknown.
+                    auto stringTableSize = IO::Endian::read<IO::EndianType::Big, uint32_t>(header + 18);
 
-                    tableA.resize(EntrySize * tableSizeA);
-                    stream->read(tableA.data(), tableA.size());
+                    // Encoding profiles for table B, each ending with a null
 
-                    // Table B
+                    auto strings = reinterpret_cast<const char*>(take(file, position, stringTableSize));
 
-                    for (auto i = 0U; i < tableSizeB; ++i)
+                    for (auto it = strings, end = strings + stringTableSize; it != end;)
                     {
-                        std::vector<char> hash(hashSizeA);
-                        std::vector<char> checksum(hashSizeA);
+                        auto last = std::find(it, end, '\0');
+                        profiles.emplace_back(it, last);
+                        it = last == end ? end : last + 1;
+                    }
 
-                        stream->read(hash.data(), hashSizeA);
-                        stream->read(checksum.data(), hashSizeA);
+                    // Table A
 
-                        headersB.emplace_back(std::make_pair(hash, checksum));
-                    }
+                    readTable(owner, position, tableA, hashSizeA, tableSizeA);
 
-                    std::reverse(headersB.begin(), headersB.end());
+                    // Table B
 
-                    tableB.resize(EntrySize * tableSizeB);
-                    stream->read(tableB.data(), tableB.size());
+                    readTable(owner, position, tableB, hashSizeB, tableSizeB);
 
                     // Encoding profile for this file
 
-                    std::string profile;
-                    std::getline(*stream, profile, '\0');
-
-                    profiles.emplace_back(profile);
+                    auto rest = reinterpret_cast<const char*>(file.data() + position);
+                    profiles.emplace_back(rest, std::find(rest, rest + (file.size() - position), '\0'));
                 }
 
             public:
@@ -432,43 +653,85 @@ namespace Casc
                 Encoding(Parsers::Binary::Reference ref,
                          std::shared_ptr<IO::StreamAllocator> allocator)
                 {
-                    // Get a file stream.
-                     auto fs = allocator->data<true, false>(ref.file());
-                    
-                    // Read size.
-                    fs->seekg(ref.offset() + 16, std::ios_base::beg);
-                    std::array<char, sizeof(uint32_t)> arr;
-                    fs->read(arr.data(), arr.size());
-                    auto size = IO::Endian::read<IO::EndianType::Little, uint32_t>(arr.begin());
-
-                    // Read params.
-                    std::string params;
-                    std::vector<char> buf(size - 20);
-                    fs->read(buf.data(), buf.size());
-                    for (int i = size - 21; i >= 2; --i)
+                    // Decode the whole file at once, since every byte of it is parsed.
+                    auto stream = allocator->data(ref, IO::AccessPattern::Sequential);
+
+                    stream->seekg(0, std::ios_base::end);
+                    auto file = std::make_shared<std::vector<uint8_t>>(size_t(stream->tellg()));
+                    stream->seekg(0, std::ios_base::beg);
+
+                    stream->read(reinterpret_cast<char*>(file->data()), file->size());
+
+                    if (size_t(stream->gcount()) != file->size())
                     {
-                        if (buf[i] == '\xDA' && buf[i - 1] == '\x78')
-                        {
-                            ZStreamBase::char_t* out = nullptr;
-                            size_t outSize = 0;
-
-                            auto inSize = size - 20 - i + 1;
-                            auto in = std::make_unique<ZStreamBase::char_t[]>(inSize);
-                            ZInflateStream(reinterpret_cast<ZStreamBase::char_t*>(
-                                buf.data() + i - 1), inSize).readAll(&out, outSize);
-                            params.assign(reinterpret_cast<char*>(out), outSize);
-                            break;
-                        }
+                        throw Exceptions::IOException("Couldn't read the encoding file.");
+                    }
+
+                    parse(file);
+                }
+
+                /**
+                 * Constructor. Parses an encoding file that's already decoded.
+                 */
+                Encoding(const std::shared_ptr<const std::vector<uint8_t>> &file)
+                {
+                    parse(file);
+                }
+
+                /**
+                 * Constructor. Reads the tables from a snapshot.
+                 */
+                Encoding(IO::Snapshot &snapshot)
+                {
+                    auto layout = snapshot.nextValue<Layout>();
+
+                    hashSizeA = size_t(layout.hashSizeA);
+                    hashSizeB = size_t(layout.hashSizeB);
+
+                    if (hashSizeA > MaxKeySize || hashSizeB > MaxKeySize)
+                    {
+                        throw Exceptions::ParserException("Unsupported key size.");
+                    }
+
+                    loadTable(snapshot, tableA, size_t(layout.pageSizeA));
+                    loadTable(snapshot, tableB, size_t(layout.pageSizeB));
+
+                    // The profiles are stored back to back, each ending with a null.
+                    auto strings = snapshot.next<char>();
+
+                    for (auto it = strings.begin(); it != strings.end();)
+                    {
+                        auto end = std::find(it, strings.end(), '\0');
+                        profiles.emplace_back(it, end);
+                        it = end == strings.end() ? end : end + 1;
+                    }
+                }
+
+                /**
+                 * Writes the tables to a snapshot.
+                 */
+                void save(IO::SnapshotWriter &writer) const
+                {
+                    writer.add(Layout{ hashSizeA, hashSizeB, tableA.pageSize, tableB.pageSize });
+
+                    saveTable(writer, tableA);
+                    saveTable(writer, tableB);
+
+                    std::vector<char> strings;
+
+                    for (auto &profile : profiles)
+                    {
+                        strings.insert(strings.end(), profile.begin(), profile.end());
+                        strings.push_back('\0');
                     }
 
-                    // Parse CASC stream.
-                    parse(allocator->data(ref));
+                    writer.add(IO::Span<const char>(strings.data(), strings.size()));
                 }
 
                 /**
-                * Copy constructor.
+                * Copy constructor (deleted).
                 */
-                Encoding(const Encoding &) = default;
+                Encoding(const Encoding &) = delete;
 
                 /**
                  * Move constructor.
@@ -476,9 +739,9 @@ namespace Casc
                 Encoding(Encoding &&) = default;
 
                 /**
-                * Copy operator.
+                * Copy operator (deleted).
                 */
-                Encoding &operator= (const Encoding &) = default;
+                Encoding &operator= (const Encoding &) = delete;
 
                 /**
                  * Move operator.
@@ -19,17 +19,24 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstring>
+#include <exception>
 #include <functional>
 #include <fstream>
 #include <map>
 #include <omp.h>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "../../Common.hpp"
 #include "../../Exceptions.hpp"
+#include "../../Key.hpp"
+
+#include "../../IO/SharedSpan.hpp"
+#include "../../IO/Snapshot.hpp"
+#include "../../IO/StreamAllocator.hpp"
 
 #include "Reference.hpp"
 
@@ -45,8 +52,10 @@ namespace Casc
             class Index
             {
             private:
-                // The files listed in the index.
-                std::unordered_map<uint32_t, Reference> files_;
+                static const size_t BucketCount = 16U;
+
+                // The files listed in the index, in one table per bucket sorted by key.
+                std::array<IO::SharedSpan<Reference>, BucketCount> buckets_;
 
                 // The versions of the .idx files.
                 std::map<uint32_t, uint32_t> versions_;
@@ -58,7 +67,7 @@ namespace Casc
                  * Finds the bucket for a file key.
                  */
                 template <typename KeyIt>
-                uint32_t findBucket(KeyIt first, KeyIt last)
+                static uint32_t findBucket(KeyIt first, KeyIt last)
                 {
                     uint8_t xorred = 0;
 
@@ -67,105 +76,193 @@ namespace Casc
                         xorred = xorred ^ *it;
                     }
 
-                    return xorred & 0xF ^ (xorred >> 4);
+                    return (xorred & 0xF) ^ (xorred >> 4);
                 }
 
                 /**
-                 * Parses an .idx file.
+                 * The version and key size of a bucket, as stored in a snapshot.
                  */
-                std::vector<Reference> parse(std::ifstream& fs)
+                struct BucketInfo
                 {
-                    uint32_t size;
-                    uint32_t hash;
-
-                    fs >> le >> size;
-                    fs >> le >> hash;
-
-                    uint32_t headerHash{ 0 };
-                    if ((hash != (headerHash = Crypto::lookup3(fs, size, 0))))
-                    {
-                        throw Exceptions::InvalidHashException(hash, headerHash, "");
-                    }
+                    uint32_t bucket;
+                    uint32_t version;
+                    uint32_t keySize;
+                };
 
+                /**
+                 * The header of an .idx file.
+                 */
+                struct Header
+                {
                     uint16_t version;
                     uint16_t bucket;
-
                     uint8_t lengthFieldSize;
                     uint8_t locationFieldSize;
                     uint8_t keyFieldSize;
                     uint8_t segmentBits;
+                };
+
+                /**
+                 * Parses an .idx file from memory.
+                 * Each hash is verified in the same pass that reads the bytes it covers.
+                 */
+                static std::vector<Reference> parse(IO::Span<const char> file, Header &header)
+                {
+                    auto read = [&file](size_t offset, size_t count)
+                    {
+                        auto view = file.subspan(offset, count);
+
+                        if (view.size() != count)
+                        {
+                            throw Exceptions::ParserException("The index file is truncated.");
+                        }
 
-                    fs >> le >> version;
-                    fs >> le >> bucket;
-                    fs >> lengthFieldSize;
-                    fs >> locationFieldSize;
-                    fs >> keyFieldSize;
-                    fs >> segmentBits;
+                        return view;
+                    };
 
-                    this->versions_[bucket] = version;
-                    this->keySize_[bucket] = keyFieldSize;
+                    auto position = size_t(0);
+                    auto field = read(position, 8);
+                    auto size = IO::Endian::read<IO::EndianType::Little, uint32_t>(field.begin());
+                    auto hash = IO::Endian::read<IO::EndianType::Little, uint32_t>(field.begin() + 4);
+                    position += field.size();
 
-                    for (unsigned int i = 0; i < (size - 8); i += 8)
-                    {
-                        uint32_t dataBeg;
-                        uint32_t dataEnd;
+                    auto headerBytes = read(position, std::max(size, 8U));
+                    auto headerHash = Crypto::lookup3(headerBytes.begin(), headerBytes.begin() + size, 0);
 
-                        fs >> be >> dataBeg;
-                        fs >> be >> dataEnd;
+                    if (hash != headerHash)
+                    {
+                        throw Exceptions::InvalidHashException(hash, headerHash, "");
                     }
 
-                    fs.seekg(16 - ((8 + size) % 16), std::ios_base::cur);
+                    header.version = IO::Endian::read<IO::EndianType::Little, uint16_t>(headerBytes.begin());
+                    header.bucket = IO::Endian::read<IO::EndianType::Little, uint16_t>(headerBytes.begin() + 2);
+                    header.lengthFieldSize = uint8_t(headerBytes[4]);
+                    header.locationFieldSize = uint8_t(headerBytes[5]);
+                    header.keyFieldSize = uint8_t(headerBytes[6]);
+                    header.segmentBits = uint8_t(headerBytes[7]);
 
-                    fs >> le >> size;
-                    fs >> le >> hash;
+                    // The entries start at the next 16 byte boundary after the header.
+                    position += size + 16 - ((8 + size) % 16);
 
-                    std::pair<uint32_t, uint32_t> dataHash{ 0, 0 };
-                    std::vector<char> data(size);
+                    field = read(position, 8);
+                    size = IO::Endian::read<IO::EndianType::Little, uint32_t>(field.begin());
+                    hash = IO::Endian::read<IO::EndianType::Little, uint32_t>(field.begin() + 4);
+                    position += field.size();
 
-                    fs.read(data.data(), data.size());
+                    auto data = read(position, size);
 
-                    std::vector<Reference> files(size / 18);
-                    files.reserve(size / 18);
+                    auto entrySize = size_t(header.keyFieldSize) + header.locationFieldSize + header.lengthFieldSize;
 
-                    for (auto i = 0U; i < (size / 18); ++i)
+                    if (entrySize == 0)
                     {
-                        auto begin = data.begin() + 18 * i;
-                        auto end = begin + 18;
+                        throw Exceptions::ParserException("Invalid index entry size.");
+                    }
 
-                        files.emplace_back(begin, end,
-                            keyFieldSize,
-                            locationFieldSize,
-                            lengthFieldSize,
-                            segmentBits);
+                    std::pair<uint32_t, uint32_t> dataHash{ 0, 0 };
 
-                        dataHash = Crypto::lookup3(begin, end, dataHash);
-                    }
+                    std::vector<Reference> files(size / entrySize);
+
+                    Reference::parseEntries(data.data(), files.size(),
+                        header.keyFieldSize,
+                        header.locationFieldSize,
+                        header.lengthFieldSize,
+                        header.segmentBits,
+                        files.data(),
+                        &dataHash);
 
                     if (hash != dataHash.first)
                     {
                         throw Exceptions::InvalidHashException(hash, dataHash.first, "");
                     }
 
-                    fs.seekg(0xE000 - ((8 + size) % 0xD000), std::ios_base::cur);
-
                     return files;
                 }
 
                 /**
-                 * Parses the .idx files.
+                 * Parses the .idx files. Each file is mapped and parsed on its own thread.
                  */
                 void parse(const std::map<uint32_t, uint32_t> &versions,
                     std::shared_ptr<IO::StreamAllocator> allocator)
                 {
                     versions_ = versions;
 
-                    for (auto i = 0; i < (int)versions.size(); ++i)
+                    auto count = int(versions.size());
+
+                    std::vector<std::vector<Reference>> parsed(count);
+                    std::vector<Header> headers(count);
+                    std::exception_ptr error;
+
+                    #pragma omp parallel for schedule(dynamic)
+                    for (auto i = 0; i < count; ++i)
+                    {
+                        try
+                        {
+                            auto file = allocator->mappedIndex(i, versions.at(i));
+
+                            parsed[i] = parse(file->view(0, file->size()), headers[i]);
+                        }
+                        catch (...)
+                        {
+                            #pragma omp critical
+                            error = std::current_exception();
+                        }
+                    }
+
+                    if (error != nullptr)
+                    {
+                        std::rethrow_exception(error);
+                    }
+
+                    std::array<std::vector<Reference>, BucketCount> buckets;
+
+                    for (auto i = 0; i < count; ++i)
+                    {
+                        versions_[headers[i].bucket] = headers[i].version;
+                        keySize_[headers[i].bucket] = headers[i].keyFieldSize;
+
+                        auto &files = parsed[i];
+
+                        // Every entry of an .idx file normally belongs to the bucket of the file, so the table is taken whole.
+                        auto bucket = i < int(BucketCount) ? uint32_t(i) : 0U;
+                        auto stray = std::stable_partition(files.begin(), files.end(),
+                            [bucket](const Reference &ref) { return findBucket(ref.key().begin(), ref.key().end()) == bucket; });
+
+                        for (auto it = stray; it != files.end(); ++it)
+                        {
+                            buckets[findBucket(it->key().begin(), it->key().end())].push_back(*it);
+                        }
+
+                        files.erase(stray, files.end());
+
+                        auto &table = buckets[bucket];
+
+                        if (table.empty())
+                        {
+                            table = std::move(files);
+                        }
+                        else
+                        {
+                            table.insert(table.end(), files.begin(), files.end());
+                        }
+                    }
+
+                    #pragma omp parallel for
+                    for (auto i = 0; i < int(BucketCount); ++i)
                     {
-                        auto files = parse(*allocator->index<true, false>(i, versions.at(i)));
-                        for (auto it = files.begin(); it != files.end(); ++it)
+                        auto &files = buckets[i];
+
+                        // The entries of an .idx file are usually sorted already.
+                        // The first entry of a key wins, so keep the order of equal keys.
+                        if (!std::is_sorted(files.begin(), files.end()))
                         {
-                            files_.insert({ Crypto::lookup3(it->key(), 0), *it });
+                            std::stable_sort(files.begin(), files.end());
                         }
+
+                        files.erase(std::unique(files.begin(), files.end(),
+                            [](const Reference &a, const Reference &b) { return a.key() == b.key(); }), files.end());
+                        files.shrink_to_fit();
+
+                        buckets_[i] = IO::SharedSpan<Reference>(std::move(files));
                     }
                 }
 
@@ -180,6 +277,23 @@ namespace Casc
                     parse(versions, allocator);
                 }
 
+                /**
+                 * Constructor. Reads the tables from a snapshot.
+                 */
+                Index(IO::Snapshot &snapshot)
+                {
+                    for (auto &info : snapshot.next<BucketInfo>())
+                    {
+                        versions_[info.bucket] = info.version;
+                        keySize_[info.bucket] = info.keySize;
+                    }
+
+                    for (auto &bucket : buckets_)
+                    {
+                        bucket = snapshot.next<Reference>();
+                    }
+                }
+
                 /**
                  * Copy constructor.
                  */
@@ -208,26 +322,63 @@ namespace Casc
                 /**
                  * Gets a file record.
                  */
-                template <typename KeyIt>
-                Reference find(KeyIt first, KeyIt last) const
+                Reference find(const IndexKey &key) const
                 {
-                    auto result = files_.find(Crypto::lookup3(first, last, 0));
+                    auto &files = buckets_[findBucket(key.begin(), key.end())];
 
-                    if (result == files_.end())
+                    // Binary search without a data dependent branch; the loop only depends on the size.
+                    auto base = files.data();
+                    auto count = files.size();
+
+                    while (count > 1)
+                    {
+                        auto half = count / 2;
+                        base = base[half].key() < key ? base + half : base;
+                        count -= half;
+                    }
+
+                    if (count > 0 && base->key() < key)
+                    {
+                        ++base;
+                    }
+
+                    if (base == files.data() + files.size() || base->key() != key)
                     {
-                        throw Exceptions::KeyDoesNotExistException(Hex(first, last).string());
+                        throw Exceptions::KeyDoesNotExistException(key.string());
                     }
 
-                    return result->second;
+                    return *base;
                 }
 
                 /**
-                * Gets a file record.
-                */
-                template <typename Container>
-                Reference find(Container container) const
+                 * Gets a file record. Keys longer than an index key are truncated.
+                 */
+                template <typename KeyIt>
+                Reference find(KeyIt first, KeyIt last) const
+                {
+                    return find(IndexKey(first, last));
+                }
+
+                /**
+                 * Writes the tables to a snapshot.
+                 */
+                void save(IO::SnapshotWriter &writer) const
                 {
-                    return find(std::begin(container), std::end(container));
+                    std::vector<BucketInfo> info;
+
+                    for (auto &version : versions_)
+                    {
+                        auto keySize = keySize_.find(version.first);
+
+                        info.push_back({ version.first, version.second, keySize != keySize_.end() ? keySize->second : 0U });
+                    }
+
+                    writer.add(IO::Span<const BucketInfo>(info.data(), info.size()));
+
+                    for (auto &bucket : buckets_)
+                    {
+                        writer.add(bucket.span());
+                    }
                 }
 
                 /**
@@ -19,11 +19,22 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <limits>
+#include <stdint.h>
+#include <utility>
 #include <vector>
 
+#if defined(__SSSE3__) || defined(__AVX__)
+#define CASC_REFERENCE_SSSE3
+#include <tmmintrin.h>
+#endif
+
 #include "../../Common.hpp"
 #include "../../Exceptions.hpp"
+#include "../../Key.hpp"
 
 namespace Casc
 {
@@ -31,52 +42,100 @@ namespace Casc
     {
         namespace Binary
         {
+            /**
+             * Where a file is stored. Packed into 18 bytes, so large indices stay small.
+             */
             class Reference
             {
-                // The key of the referenced file.
-                std::vector<char> key_;
+            public:
+                // The size of the keys in the index.
+                static const size_t KeySize = 9U;
+
+                // The number of bits of the offset in the packed location.
+                static const size_t OffsetBits = 30U;
+
+                // The number of bits of the file number in the packed location.
+                static const size_t FileBits = 10U;
+
+                typedef IndexKey key_type;
 
-                // The file number.
-                // Max value of this field is 2^10 (10 bit).
-                size_t file_ = 0;
+            private:
+                // The key of the referenced file. Shorter keys are padded with zeros.
+                key_type key_;
 
-                // The offset into the file. This is where the memory block starts.
-                // Max value of this field is 2^30 (30 bit).
-                size_t offset_ = 0;
+                // The file number and the offset into the file, packed little endian into 40 bits.
+                // The offset is where the memory block starts.
+                std::array<uint8_t, 5> location_;
 
-                // The amount bytes in the memory block.
-                // Max value of this field is 2^30 (30 bit).
-                size_t size_ = 0;
+                // The amount bytes in the memory block, little endian.
+                std::array<uint8_t, 4> size_;
+
+                /**
+                 * Packs the location and size.
+                 */
+                void pack(size_t file, size_t offset, size_t size)
+                {
+                    if (file >> FileBits != 0 || offset >> OffsetBits != 0 || size > std::numeric_limits<uint32_t>::max())
+                    {
+                        throw Exceptions::ParserException("Field value is outside the accepted range.");
+                    }
+
+                    auto location = uint64_t(file) << OffsetBits | offset;
+
+                    for (size_t i = 0; i < location_.size(); ++i)
+                    {
+                        location_[i] = uint8_t(location >> (i * 8));
+                    }
+
+                    for (size_t i = 0; i < size_.size(); ++i)
+                    {
+                        size_[i] = uint8_t(size >> (i * 8));
+                    }
+                }
+
+                /**
+                 * Unpacks the location.
+                 */
+                uint64_t location() const
+                {
+                    uint64_t location = 0;
+
+                    for (size_t i = 0; i < location_.size(); ++i)
+                    {
+                        location |= uint64_t(location_[i]) << (i * 8);
+                    }
+
+                    return location;
+                }
 
             public:
                 /**
                  * Default constructor.
                  */
-                Reference() { }
+                Reference()
+                    : location_(), size_()
+                {
+                }
 
                 /**
                  * Constructor.
                  */
                 template <typename KeyIt>
                 Reference(KeyIt first, KeyIt last, size_t file, size_t offset, size_t length)
-                    : key_(first, last), file_(file), offset_(offset), size_(length)
+                    : key_(first, last)
                 {
+                    pack(file, offset, length);
                 }
 
                 /**
-                 * Constructor.
+                 * Constructor. Parses an entry of an .idx file.
                  */
                 template <typename InputIt>
                 Reference(InputIt first, InputIt last,
                     size_t keySize, size_t locationSize, size_t lengthSize, size_t segmentBits)
+                    : key_(first, first + keySize)
                 {
-                    auto it = first;
-
-                    std::vector<char> key(keySize);
-                    std::copy(it, it + keySize, key.begin());
-                    it += keySize;
-
-                    this->key_ = key;
+                    auto it = first + keySize;
 
                     auto offsetSize = (segmentBits + 7U) / 8U;
                     auto fileSize = locationSize - offsetSize;
@@ -93,47 +152,19 @@ namespace Casc
                     auto size = IO::Endian::read<IO::EndianType::Little, size_t>(it, it + lengthSize);
                     it += lengthSize;
 
+                    // The bits of the offset field above the segment bits belong to the file number.
                     auto extraBits = (offsetSize * 8U) - segmentBits;
                     file <<= extraBits;
+                    file |= offset >> segmentBits;
+                    offset &= (size_t(1) << segmentBits) - 1U;
 
-                    auto bits = offset >> segmentBits;
-                    file |= bits;
-                    offset &= (std::numeric_limits<size_t>::max() >> extraBits);
-
-                    this->file_ = file;
-                    this->offset_ = offset;
-                    this->size_ = size;
+                    pack(file, offset, size);
                 }
 
-                /**
-                 * Copy constructor.
-                 */
-                Reference(const Reference &) = default;
-
-                /**
-                 * Move constructor.
-                 */
-                Reference(Reference &&) = default;
-
-                /**
-                 * Copy operator.
-                 */
-                Reference &operator= (const Reference &) = default;
-
-                /**
-                 * Move operator.
-                 */
-                Reference &operator= (Reference &&) = default;
-
-                /**
-                 * Destructor
-                 */
-                virtual ~Reference() = default;
-
                 /**
                  * The key.
                  */
-                const std::vector<char> &key() const
+                const key_type &key() const
                 {
                     return key_;
                 }
@@ -143,7 +174,7 @@ namespace Casc
                  */
                 size_t file() const
                 {
-                    return file_;
+                    return size_t(location() >> OffsetBits);
                 }
 
                 /**
@@ -151,7 +182,7 @@ namespace Casc
                  */
                 size_t offset() const
                 {
-                    return offset_;
+                    return size_t(location() & ((uint64_t(1) << OffsetBits) - 1U));
                 }
 
                 /**
@@ -159,7 +190,82 @@ namespace Casc
                  */
                 size_t size() const
                 {
-                    return size_;
+                    return size_t(size_[0]) | size_t(size_[1]) << 8 | size_t(size_[2]) << 16 | size_t(size_[3]) << 24;
+                }
+
+                /**
+                 * Parses consecutive entries of an .idx file into references.
+                 * Entries with the usual layout (a 9 byte key, a 5 byte location with 30 offset bits and a 4 byte size)
+                 * already hold the packed fields, only with the location byte swapped, so they're converted
+                 * by shuffling bytes, 16 at a time where SSSE3 is available. Other layouts are parsed one entry at a time.
+                 * When a hash is given, each entry is chained into it with lookup3 while it's converted.
+                 */
+                static void parseEntries(const char *entries, size_t count,
+                    size_t keySize, size_t locationSize, size_t lengthSize, size_t segmentBits, Reference *out,
+                    std::pair<uint32_t, uint32_t> *hash = nullptr)
+                {
+                    static_assert(sizeof(Reference) == KeySize + 5 + 4, "References have to be packed to be shuffled into.");
+
+                    auto entrySize = keySize + locationSize + lengthSize;
+
+                    if (keySize != KeySize || locationSize != 5 || lengthSize != 4 || segmentBits != OffsetBits)
+                    {
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            auto entry = entries + entrySize * i;
+                            out[i] = Reference(entry, entry + entrySize, keySize, locationSize, lengthSize, segmentBits);
+
+                            if (hash != nullptr)
+                            {
+                                *hash = Crypto::lookup3(entry, entry + entrySize, *hash);
+                            }
+                        }
+
+                        return;
+                    }
+
+                    // The fields are stored in declaration order: key, location, size.
+                    auto output = reinterpret_cast<char*>(out);
+
+#ifdef CASC_REFERENCE_SSSE3
+                    // Keeps the key, reverses the location and keeps the first two bytes of the size.
+                    auto shuffle = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 13, 12, 11, 10, 9, 14, 15);
+
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        auto entry = entries + entrySize * i;
+                        auto reference = output + sizeof(Reference) * i;
+
+                        auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(entry));
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(reference), _mm_shuffle_epi8(bytes, shuffle));
+                        std::memcpy(reference + 16, entry + 16, 2);
+
+                        if (hash != nullptr)
+                        {
+                            *hash = Crypto::lookup3(entry, entry + entrySize, *hash);
+                        }
+                    }
+#else
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        auto entry = entries + entrySize * i;
+                        auto reference = output + sizeof(Reference) * i;
+
+                        std::memcpy(reference, entry, KeySize);
+                        std::reverse_copy(entry + KeySize, entry + KeySize + 5, reference + KeySize);
+                        std::memcpy(reference + KeySize + 5, entry + KeySize + 5, 4);
+
+                        if (hash != nullptr)
+                        {
+                            *hash = Crypto::lookup3(entry, entry + entrySize, *hash);
+                        }
+                    }
+#endif
+                }
+
+                bool operator <(const Reference &b) const
+                {
+                    return key_ < b.key_;
                 }
             };
         }
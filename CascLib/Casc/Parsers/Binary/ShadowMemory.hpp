@@ -19,25 +19,16 @@
 
 #pragma once
 
-#include <array>
-#ifdef _MSC_VER
-#include <experimental/filesystem>
-#else
-#include <boost/filesystem.hpp>
-#endif
 #include <fstream>
-#include <iomanip>
-#include <limits>
-#include <locale>
 #include <map>
-#include <sstream>
+#include <memory>
 #include <stdint.h>
-#include <string>
 #include <vector>
 
 #include "../../Common.hpp"
-
-#include "Reference.hpp"
+#include "../../Exceptions.hpp"
+#include "../../IO/Endian.hpp"
+#include "../../IO/Span.hpp"
 
 namespace Casc
 {
@@ -53,7 +44,17 @@ namespace Casc
             {
             private:
                 static const int EntriesPerBlock = 1090U;
-                static const int BlockSize = EntriesPerBlock * 5U;
+                static const int EntrySize = 5U;
+                static const int BlockSize = EntriesPerBlock * EntrySize;
+
+                // The size of the header up to the block table: type, size and data path.
+                static const size_t HeaderSize = 264U;
+
+                // The size of a free space block up to the tables: type, entry count and padding.
+                static const size_t FreeSpaceHeaderSize = 32U;
+
+                // The number of .idx buckets, each with a version in the header.
+                static const size_t VersionCount = 16U;
 
                 /**
                 * Different SHMEM block types:
@@ -69,172 +70,161 @@ namespace Casc
                 // The list of versions for IDX files. Contains 16 values for WoD beta.
                 std::map<uint32_t, uint32_t> versions_;
 
-                // The list of free spaces of memory in the data files. 
-                std::vector<Reference> freeSpaceLength_;
-                std::vector<Reference> freeSpaceOffset_;
+                // The lengths of the free spaces of memory in the data files.
+                std::vector<uint64_t> freeSpaceLength_;
+
+                // The locations of the free spaces of memory in the data files.
+                std::vector<uint64_t> freeSpaceOffset_;
 
                 /**
-                 * Reads a block of type BlockType::WriteableMemory.
+                 * Reads a little endian 32-bit field, checking that it's inside the file.
                  */
-                void readFreeSpace(std::ifstream &file)
+                static uint32_t readField(IO::Span<const char> data, size_t position)
                 {
-                    uint32_t writeableMemoryCount;
-                    file >> writeableMemoryCount;
-
-                    file.seekg(24, std::ios_base::cur);
-
-                    for (auto i = 0U; i < EntriesPerBlock; ++i)
+                    if (position > data.size() || data.size() - position < sizeof(uint32_t))
                     {
-                        std::array<char, 5> arr;
-                        file.read(arr.data(), 5);
-
-                        if (i < writeableMemoryCount)
-                        {
-                            freeSpaceLength_.emplace_back(arr.begin(), arr.end(), 0, 5, 0, 30);
-                        }
+                        throw Exceptions::ParserException("Shadow memory field is outside the file.");
                     }
 
-                    for (auto i = 0U; i < EntriesPerBlock; ++i)
-                    {
-                        std::array<char, 5> arr;
-                        file.read(arr.data(), 5);
-
-                        if (i < writeableMemoryCount)
-                        {
-                            freeSpaceOffset_.emplace_back(arr.begin(), arr.end(), 0, 5, 0, 30);
-                        }
-                    }
+                    return IO::Endian::read<IO::EndianType::Little, uint32_t>(data.data() + position);
                 }
 
                 /**
-                 * Reads a block of type BlockType::Header.
+                 * Reads a 40-bit big endian free space entry.
                  */
-                void readHeader(std::ifstream &file)
+                static uint64_t readEntry(const char *entry)
                 {
-                    uint32_t headerSize;
-                    file >> le >> headerSize;
+                    return uint64_t(uint8_t(entry[0])) << 32 |
+                        IO::Endian::read<IO::EndianType::Big, uint32_t>(entry + 1);
+                }
 
-                    std::string path(256, '\0');
-                    file.read(&path[0], 256);
+                /**
+                 * Reads a block of type BlockType::FreeSpace.
+                 */
+                void readFreeSpace(IO::Span<const char> data, size_t position)
+                {
+                    auto count = readField(data, position + 4);
 
-                    int pathTypeLength = path.find_first_of(R"(\)");
-                    if (pathTypeLength != -1)
+                    if (count > size_t(EntriesPerBlock) || data.size() - position < FreeSpaceHeaderSize + BlockSize * 2)
                     {
-                        std::string pathType = path.substr(0, pathTypeLength);
-
-                        if (pathType.compare("Global") == 0)
-                        {
-                            path.assign(path.substr(pathTypeLength + 1));
-                        }
+                        throw Exceptions::ParserException("Invalid free space block.");
                     }
 
-                    path.resize(path.find_first_of('\0'));
+                    auto lengths = data.data() + position + FreeSpaceHeaderSize;
+                    auto offsets = lengths + BlockSize;
 
-                    for (fs::directory_iterator iter(path), end; iter != end; ++iter)
-                    {
-                        if (!fs::is_directory(iter->path()))
-                        {
-                            auto ext = iter->path().extension();
-                            auto fn = iter->path().filename();
+                    freeSpaceLength_.reserve(freeSpaceLength_.size() + count);
+                    freeSpaceOffset_.reserve(freeSpaceOffset_.size() + count);
 
-                            if (ext.compare(".idx") == 0)
-                            {
-                                std::stringstream ss;
-                                ss << std::hex << fn.string().substr(0, 2);
+                    for (auto i = 0U; i < count; ++i)
+                    {
+                        freeSpaceLength_.push_back(readEntry(lengths + i * EntrySize));
+                        freeSpaceOffset_.push_back(readEntry(offsets + i * EntrySize));
+                    }
+                }
 
-                                unsigned int index;
-                                ss >> index;
+                /**
+                 * Reads a block of type BlockType::Header.
+                 * The header lists the other blocks and ends with the version of each bucket's .idx file.
+                 */
+                void readHeader(IO::Span<const char> data)
+                {
+                    auto headerSize = size_t(readField(data, 4));
 
-                                versions_[index] = 0;
-                            }
-                        }
+                    if (headerSize < HeaderSize + VersionCount * sizeof(uint32_t) || headerSize > data.size())
+                    {
+                        throw Exceptions::ParserException("Invalid shadow memory header size.");
                     }
 
-                    auto blockCount = (headerSize - 264 - versions_.size() * sizeof(uint32_t)) / (sizeof(uint32_t) * 2);
+                    auto blockCount = (headerSize - HeaderSize - VersionCount * sizeof(uint32_t)) / (sizeof(uint32_t) * 2);
+                    auto position = size_t(HeaderSize);
 
-                    std::vector<std::pair<uint32_t, uint32_t>> blocks(blockCount);
+                    std::vector<size_t> blocks(blockCount);
 
-                    for (unsigned int i = 0; i < blockCount; ++i)
+                    for (auto &block : blocks)
                     {
-                        file >> le >> blocks[i].first;
-                        file >> le >> blocks[i].second;
+                        block = readField(data, position + 4);
+                        position += sizeof(uint32_t) * 2;
                     }
 
-                    for (unsigned int i = 0; i < versions_.size(); ++i)
+                    for (auto i = 0U; i < VersionCount; ++i)
                     {
-                        file >> le >> versions_[i];
+                        versions_[i] = readField(data, position);
+                        position += sizeof(uint32_t);
                     }
 
-                    for (unsigned int i = 0; i < blockCount; ++i)
+                    for (auto block : blocks)
                     {
-                        file.seekg(blocks[i].second);
-
-                        uint32_t type = 0;
-                        file >> le >> type;
-
-                        switch (type)
+                        switch (readField(data, block))
                         {
                         case BlockType::Header:
                             break;
 
                         case BlockType::FreeSpace:
-                            readFreeSpace(file);
+                            readFreeSpace(data, block);
                             break;
                         }
                     }
                 }
 
+            public:
                 /**
-                 * Reads a shadow memory file.
+                 * Constructor. Reads the whole file at once.
                  */
-                void readFile(std::shared_ptr<std::ifstream> stream)
+                ShadowMemory(std::shared_ptr<std::ifstream> stream)
                 {
-                    uint32_t type = 0;
-                    *stream >> le >> type;
-
-                    switch (type)
-                    {
-                    case BlockType::Header:
-                        readHeader(*stream);
-                        break;
-
-                    case BlockType::FreeSpace:
-                        break;
-                    }
-
-                    stream->close();
+                    parse(stream);
                 }
 
                 /**
-                 * Calculates how many blocks are needed for entries.
+                 * Constructor. Parses a shadow memory file in memory.
                  */
-                size_t calcBlockCount(size_t count) const
+                ShadowMemory(IO::Span<const char> data)
                 {
-                    return (count % 1090) == 0 ? count / 1090 : 1 + count / 1090;
+                    parse(data);
                 }
 
-            public:
                 /**
-                 * Constructor.
+                 * Destructor.
                  */
-                ShadowMemory(std::shared_ptr<std::ifstream> stream)
+                virtual ~ShadowMemory()
                 {
-                    parse(stream);
                 }
 
                 /**
-                 * Destructor.
+                 * Parses a shadow memory file.
                  */
-                virtual ~ShadowMemory()
+                void parse(std::shared_ptr<std::ifstream> stream)
                 {
+                    stream->seekg(0, std::ios_base::end);
+                    std::vector<char> data(size_t(stream->tellg()));
+                    stream->seekg(0, std::ios_base::beg);
+
+                    stream->read(data.data(), data.size());
+
+                    if (size_t(stream->gcount()) != data.size())
+                    {
+                        throw Exceptions::IOException("Couldn't read the shadow memory file.");
+                    }
+
+                    stream->close();
+
+                    parse(IO::Span<const char>(data.data(), data.size()));
                 }
 
                 /**
-                 * Parses a shadow memory file.
+                 * Parses a shadow memory file in memory.
                  */
-                void parse(std::shared_ptr<std::ifstream> stream)
+                void parse(IO::Span<const char> data)
                 {
-                    readFile(stream);
+                    versions_.clear();
+                    freeSpaceLength_.clear();
+                    freeSpaceOffset_.clear();
+
+                    if (readField(data, 0) == BlockType::Header)
+                    {
+                        readHeader(data);
+                    }
                 }
 
                 /**
@@ -244,6 +234,23 @@ namespace Casc
                 {
                     return versions_;
                 }
+
+                /**
+                 * Gets the lengths of the free spaces in the data files.
+                 */
+                const std::vector<uint64_t> &freeSpaceLengths() const
+                {
+                    return freeSpaceLength_;
+                }
+
+                /**
+                 * Gets the locations of the free spaces in the data files.
+                 * Each packs the data file number above an offset of Reference::OffsetBits bits.
+                 */
+                const std::vector<uint64_t> &freeSpaceOffsets() const
+                {
+                    return freeSpaceOffset_;
+                }
             };
         }
     }
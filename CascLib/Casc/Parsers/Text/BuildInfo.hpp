@@ -20,14 +20,14 @@
 #pragma once
 
 #include <fstream>
-#include <map>
-#include <memory>
-#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "../../Common.hpp"
 #include "../../Exceptions.hpp"
+#include "../../StringView.hpp"
 
 namespace Casc
 {
@@ -40,27 +40,132 @@ namespace Casc
             */
             class BuildInfo
             {
-                // The key structure.
-                struct Key
+            public:
+                /**
+                 * The values of a build, looked up by column name. Only valid while the build info is.
+                 */
+                class Build
                 {
-                    std::string name;
-                    std::string type;
-                    int length;
+                    // The parsed file.
+                    const BuildInfo *info;
+
+                    // The first value of the build.
+                    const StringView *values;
+
+                public:
+                    /**
+                     * Constructor.
+                     */
+                    Build(const BuildInfo *info, const StringView *values)
+                        : info(info), values(values)
+                    {
+                    }
+
+                    /**
+                     * Gets the value of a column. Throws std::out_of_range when there's no such column.
+                     */
+                    const StringView &at(StringView name) const
+                    {
+                        return values[info->column(name)];
+                    }
+
+                    /**
+                     * Gets the number of columns with a name, either 0 or 1.
+                     */
+                    size_t count(StringView name) const
+                    {
+                        return info->columnIndex.count(name);
+                    }
+
+                    /**
+                     * Gets the number of values.
+                     */
+                    size_t size() const
+                    {
+                        return info->columns.size();
+                    }
                 };
 
-                // Parser states.
-                enum class State
+            private:
+                // The column structure.
+                struct Column
                 {
-                    KeyBegin,
-                    Key,
-                    Type,
-                    Size,
-                    ValueBegin,
-                    Value
+                    StringView name;
+                    StringView type;
+                    int length;
                 };
 
-                // The parsed values.
-                std::vector<std::map<std::string, std::string>> values;
+                // The contents of the file. The views below point into it.
+                std::vector<char> text;
+
+                // The columns, in the order of the values.
+                std::vector<Column> columns;
+
+                // The column number of each column name.
+                std::unordered_map<StringView, size_t> columnIndex;
+
+                // The values of every build, one row of columns after the other.
+                std::vector<StringView> values;
+
+                /**
+                 * Gets the column number of a column name.
+                 */
+                size_t column(StringView name) const
+                {
+                    auto it = columnIndex.find(name);
+
+                    if (it == columnIndex.end())
+                    {
+                        throw std::out_of_range("The build info has no column named " + name.string() + ".");
+                    }
+
+                    return it->second;
+                }
+
+                /**
+                 * Splits a line on a separator, passing each field to a function.
+                 */
+                template <typename Function>
+                static void split(StringView line, char separator, Function fn)
+                {
+                    size_t first = 0;
+
+                    for (auto last = line.find(separator); last != StringView::npos; last = line.find(separator, first))
+                    {
+                        fn(line.substr(first, last - first));
+                        first = last + 1;
+                    }
+
+                    fn(line.substr(first));
+                }
+
+                /**
+                 * Parses a header field, e.g. "Build Key!HEX:16".
+                 */
+                static Column parseColumn(StringView field)
+                {
+                    auto bang = field.find('!');
+                    auto colon = field.find(':', bang == StringView::npos ? field.size() : bang);
+
+                    Column column{ field.substr(0, bang), StringView(), 0 };
+
+                    if (bang != StringView::npos)
+                    {
+                        column.type = field.substr(bang + 1, colon - bang - 1);
+                    }
+
+                    for (auto ch : field.substr(colon == StringView::npos ? field.size() : colon + 1))
+                    {
+                        if (ch < '0' || ch > '9')
+                        {
+                            break;
+                        }
+
+                        column.length = column.length * 10 + (ch - '0');
+                    }
+
+                    return column;
+                }
 
             public:
                 /**
@@ -71,6 +176,26 @@ namespace Casc
                     parse(path);
                 }
 
+                /**
+                 * Copy constructor (deleted). The values point into the text of the file.
+                 */
+                BuildInfo(const BuildInfo &) = delete;
+
+                /**
+                 * Copy operator (deleted).
+                 */
+                BuildInfo &operator= (const BuildInfo &) = delete;
+
+                /**
+                 * Move constructor.
+                 */
+                BuildInfo(BuildInfo &&) = default;
+
+                /**
+                 * Move operator.
+                 */
+                BuildInfo &operator= (BuildInfo &&) = default;
+
                 /**
                  * Destructor.
                  */
@@ -81,9 +206,14 @@ namespace Casc
                 /**
                 * Gets the values for a build from the last parsed .build.info file.
                 */
-                const std::map<std::string, std::string> &build(int index) const
+                Build build(int index) const
                 {
-                    return values.at(index);
+                    if (index < 0 || index >= size())
+                    {
+                        throw std::out_of_range("The build info has no such build.");
+                    }
+
+                    return Build(this, values.data() + size_t(index) * columns.size());
                 }
 
                 /**
@@ -91,159 +221,67 @@ namespace Casc
                  */
                 int size() const
                 {
-                    return values.size();
+                    return columns.empty() ? 0 : int(values.size() / columns.size());
                 }
 
                 /**
                  * Clears old values and parses a .build.info file.
+                 * The file is read at once, and the names and values are views of its text.
                  */
                 void parse(const std::string path)
                 {
-                    if (!fs::exists(path))
+                    std::ifstream fs(path, std::ios_base::in | std::ios_base::binary);
+
+                    if (!fs.is_open())
                     {
                         throw Exceptions::FileNotFoundException(path);
                     }
 
-                    values.clear();
-
-                    State currentState = State::KeyBegin;
-
-                    int bufferCurrent = -1;
-                    int bufferSize = 0;
-                    std::unique_ptr<char[]> buffer = nullptr;
-
-                    std::ifstream fs;
-
-                    fs.open(path, std::ios_base::in);
                     fs.seekg(0, std::ios_base::end);
-
-                    bufferSize = (int)fs.tellg();
-                    bufferSize += 1;
-
-                    buffer = std::make_unique<char[]>(bufferSize);
-
+                    std::vector<char> contents(size_t(fs.tellg()));
                     fs.seekg(0, std::ios_base::beg);
 
-                    std::vector<Key> keys;
-                    std::string str;
+                    fs.read(contents.data(), contents.size());
 
-                    int index = -1;
-
-                    while (!fs.eof())
+                    if (size_t(fs.gcount()) != contents.size())
                     {
-                        char ch = fs.get();
-                        std::stringstream ss;
-
-                        switch (currentState)
-                        {
-                        case State::KeyBegin:
-                            currentState = State::Key;
-                            buffer[++bufferCurrent] = ch;
-                            break;
-
-                        case State::Key:
-                            switch (ch)
-                            {
-                            case '!':
-                                currentState = State::Type;
-                                buffer[++bufferCurrent] = '\0';
-                                bufferCurrent = -1;
-
-                                keys.push_back({ buffer.get() });
-                                break;
-
-                            default:
-                                buffer[++bufferCurrent] = ch;
-                                break;
-                            }
-                            break;
-
-                        case State::Type:
-                            switch (ch)
-                            {
-                            case ':':
-                                currentState = State::Size;
-                                buffer[++bufferCurrent] = '\0';
-                                bufferCurrent = -1;
-
-                                keys.back().type = buffer.get();
-                                break;
-
-                            default:
-                                buffer[++bufferCurrent] = ch;
-                                break;
-                            }
-                            break;
-
-                        case State::Size:
-                            switch (ch)
-                            {
-                            case '|':
-                                currentState = State::KeyBegin;
-                                buffer[++bufferCurrent] = '\0';
-                                bufferCurrent = -1;
-
-                                ss << buffer.get();
-                                ss >> keys.back().length;
-
-                                keys.back().type = buffer.get();
-                                break;
-
-                            case '\n':
-                                currentState = State::ValueBegin;
-                                buffer[++bufferCurrent] = '\0';
-                                bufferCurrent = -1;
-
-                                ss << buffer.get();
-                                ss >> keys.back().length;
-
-                                keys.back().type = buffer.get();
-                                break;
-
-                            default:
-                                buffer[++bufferCurrent] = ch;
-                                break;
-                            }
-                            break;
+                        throw Exceptions::IOException("Couldn't read the build info file.");
+                    }
 
-                        case State::ValueBegin:
-                            if (fs.eof())
-                            {
-                                break;
-                            }
+                    text = std::move(contents);
+                    columns.clear();
+                    columnIndex.clear();
+                    values.clear();
 
-                            currentState = State::Value;
-                            buffer[++bufferCurrent] = ch;
+                    split(StringView(text.data(), text.size()), '\n', [this](StringView line)
+                    {
+                        line = line.trim();
 
-                            values.resize(values.size() + 1);
-                            break;
+                        if (line.empty())
+                        {
+                            return;
+                        }
 
-                        case State::Value:
-                            switch (ch)
+                        if (columns.empty())
+                        {
+                            split(line, '|', [this](StringView field)
                             {
-                            case '|':
-                                buffer[++bufferCurrent] = '\0';
-                                bufferCurrent = -1;
+                                columnIndex.emplace(field.substr(0, field.find('!')), columns.size());
+                                columns.push_back(parseColumn(field));
+                            });
 
-                                str = buffer.get();
+                            return;
+                        }
 
-                                values.back()[keys[++index].name] = buffer.get();
-                                break;
+                        auto first = values.size();
 
-                            case '\n':
-                                currentState = State::ValueBegin;
-                                index = -1;
-                                break;
+                        split(line, '|', [this](StringView field) { values.push_back(field); });
 
-                            default:
-                                buffer[++bufferCurrent] = ch;
-                                break;
-                            }
-                            break;
+                        if (values.size() - first != columns.size())
+                        {
+                            throw Exceptions::ParserException("A build has a different number of values than there are columns.");
                         }
-                    }
-
-                    fs.close();
+                    });
                 }
             };
         }
@@ -19,14 +19,18 @@
 
 #pragma once
 
+#include <algorithm>
 #include <fstream>
-#include <map>
-#include <sstream>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "../../Common.hpp"
 #include "../../Exceptions.hpp"
+#include "../../IO/Span.hpp"
+#include "../../StringView.hpp"
 
 namespace Casc
 {
@@ -39,104 +43,81 @@ namespace Casc
              */
             class Configuration
             {
-                // The token types that can be parsed.
-                enum class TokenType
-                {
-                    None,
-                    Comment,
-                    Key,
-                    Operator,
-                    Value
-                };
-
-                // The type of the token currently being parsed.
-                TokenType currentToken = TokenType::None;
+                // The contents of the file. The views below point into it.
+                std::vector<char> text_;
 
-                // The parsed values.
-                std::map<std::string, std::vector<std::string>> values_;
+                // The values of every key, one key after the other.
+                std::vector<StringView> tokens_;
 
-                /**
-                 * Trims the leading and trailing whitespace of a string.
-                 */
-                std::string trim(const std::string s)
-                {
-                    int(*pred)(int c) = std::isspace;
-                    auto wsfront = std::find_if_not(s.begin(), s.end(), pred);
-                    auto wsback = std::find_if_not(s.rbegin(), s.rend(), pred).base();
-                    return (wsback <= wsfront ? std::string() : std::string(wsfront, wsback));
-                }
+                // The first token and the number of tokens of each key.
+                std::unordered_map<StringView, std::pair<size_t, size_t>> values_;
 
                 /**
                 * Clears old values and parses a configuration file.
+                * The file is read at once, and the keys and values are views of its text.
                 */
                 void parse(std::ifstream &fs)
                 {
-                    values_.clear();
+                    fs.seekg(0, std::ios_base::end);
+                    std::vector<char> contents(size_t(fs.tellg()));
+                    fs.seekg(0, std::ios_base::beg);
 
-                    char ch{};
-                    char buffer[256]{};
+                    fs.read(contents.data(), contents.size());
 
-                    std::string key;
-                    std::string value;
+                    if (size_t(fs.gcount()) != contents.size())
+                    {
+                        throw Exceptions::IOException("Couldn't read the configuration file.");
+                    }
+
+                    fs.close();
 
-                    while (!fs.eof())
+                    text_ = std::move(contents);
+                    tokens_.clear();
+                    values_.clear();
+
+                    StringView text(text_.data(), text_.size());
+                    std::pair<size_t, size_t> *current = nullptr;
+
+                    for (size_t first = 0; first < text.size();)
                     {
-                        switch (currentToken)
+                        auto last = std::min(text.find('\n', first), text.size());
+                        auto line = text.substr(first, last - first);
+                        first = last + 1;
+
+                        if (line.trim().empty() || line[0] == '#')
+                        {
+                            continue;
+                        }
+
+                        // Lines starting with a space continue the values of the key before.
+                        if (!StringView::isSpace(line[0]))
+                        {
+                            auto separator = line.find('=');
+
+                            auto key = line.substr(0, separator).trim();
+                            line = line.substr(separator == StringView::npos ? line.size() : separator + 1);
+
+                            current = &values_[key];
+                            *current = std::make_pair(tokens_.size(), size_t(0));
+                        }
+
+                        if (current == nullptr)
+                        {
+                            continue;
+                        }
+
+                        for (auto it = line.begin(); it != line.end();)
                         {
-                        case TokenType::None:
-                            ch = fs.peek();
+                            auto begin = std::find_if_not(it, line.end(), StringView::isSpace);
+                            it = std::find_if(begin, line.end(), StringView::isSpace);
 
-                            switch (ch)
+                            if (begin != it)
                             {
-                            case '#':
-                                currentToken = TokenType::Comment;
-                                break;
-
-                            case '\n':
-                                fs.get();
-                                break;
-
-                            case ' ':
-                                fs.get();
-                                currentToken = TokenType::Value;
-                                break;
-
-                            default:
-                                currentToken = TokenType::Key;
-                                break;
+                                tokens_.emplace_back(begin, size_t(it - begin));
+                                ++current->second;
                             }
-                            break;
-
-                        case TokenType::Comment:
-                            fs.getline(buffer, 256);
-                            currentToken = TokenType::None;
-                            break;
-
-                        case TokenType::Key:
-                            fs.getline(buffer, 256, '=');
-                            key = trim(buffer);
-                            currentToken = TokenType::Operator;
-                            break;
-
-                        case TokenType::Operator:
-                            ch = fs.get();
-                            currentToken = TokenType::Value;
-                            break;
-
-                        case TokenType::Value:
-                            std::getline(fs, value);
-                            std::istringstream ss(value);
-                            values_[key] = std::vector<std::string>
-                            {
-                                std::istream_iterator<std::string>{ss},
-                                std::istream_iterator<std::string>{}
-                            };
-                            currentToken = TokenType::None;
-                            break;
                         }
                     }
-
-                    fs.close();
                 }
 
             public:
@@ -148,6 +129,26 @@ namespace Casc
                     parse(*fs);
                 }
 
+                /**
+                 * Copy constructor (deleted). The values point into the text of the file.
+                 */
+                Configuration(const Configuration &) = delete;
+
+                /**
+                 * Copy operator (deleted).
+                 */
+                Configuration &operator= (const Configuration &) = delete;
+
+                /**
+                 * Move constructor.
+                 */
+                Configuration(Configuration &&) = default;
+
+                /**
+                 * Move operator.
+                 */
+                Configuration &operator= (Configuration &&) = default;
+
                 /**
                  * Destructor.
                  */
@@ -157,11 +158,13 @@ namespace Casc
                 }
 
                 /**
-                 * Gets the value for a key.
+                 * Gets the values for a key. Throws std::out_of_range when there's no such key.
                  */
-                const std::vector<std::string> &operator[] (const std::string key) const
+                IO::Span<const StringView> operator[] (StringView key) const
                 {
-                    return values_.at(key);
+                    auto &range = values_.at(key);
+
+                    return IO::Span<const StringView>(tokens_.data() + range.first, range.second);
                 }
             };
         }
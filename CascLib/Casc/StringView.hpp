@@ -0,0 +1,231 @@
+/*
+* Copyright 2015 Gunnar Lilleaasen
+*
+* This file is part of CascLib.
+*
+* CascLib is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+
+* CascLib is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CascLib.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace Casc
+{
+    /**
+     * A non-owning view of a string. The viewed characters have to outlive the view.
+     */
+    class StringView
+    {
+    public:
+        typedef const char *iterator;
+        typedef const char *const_iterator;
+
+        // Returned by find when nothing was found.
+        static const size_t npos = size_t(-1);
+
+    private:
+        // The first character.
+        const char *data_ = nullptr;
+
+        // The number of characters.
+        size_t size_ = 0;
+
+    public:
+        /**
+         * Default constructor. Creates an empty view.
+         */
+        StringView() { }
+
+        /**
+         * Constructor.
+         */
+        StringView(const char *data, size_t size)
+            : data_(data), size_(size)
+        {
+        }
+
+        /**
+         * Constructor. Views a null-terminated string.
+         */
+        StringView(const char *str)
+            : data_(str), size_(std::strlen(str))
+        {
+        }
+
+        /**
+         * Constructor. Views the characters of a string.
+         */
+        StringView(const std::string &str)
+            : data_(str.data()), size_(str.size())
+        {
+        }
+
+        const char *data() const noexcept
+        {
+            return data_;
+        }
+
+        size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+
+        iterator begin() const noexcept
+        {
+            return data_;
+        }
+
+        iterator end() const noexcept
+        {
+            return data_ + size_;
+        }
+
+        char operator[](size_t index) const
+        {
+            return data_[index];
+        }
+
+        /**
+         * Gets a view of a part of the string. The count is clamped to the available characters.
+         */
+        StringView substr(size_t offset, size_t count = npos) const
+        {
+            if (offset >= size_)
+            {
+                return StringView();
+            }
+
+            return StringView(data_ + offset, std::min(count, size_ - offset));
+        }
+
+        /**
+         * Finds the first occurrence of a character at or after an offset.
+         */
+        size_t find(char ch, size_t offset = 0) const
+        {
+            if (offset >= size_)
+            {
+                return npos;
+            }
+
+            auto found = static_cast<const char*>(std::memchr(data_ + offset, ch, size_ - offset));
+
+            return found != nullptr ? size_t(found - data_) : npos;
+        }
+
+        /**
+         * Gets a view without the leading and trailing whitespace.
+         */
+        StringView trim() const
+        {
+            auto first = std::find_if_not(begin(), end(), isSpace);
+            auto last = std::find_if_not(std::reverse_iterator<iterator>(end()),
+                std::reverse_iterator<iterator>(first), isSpace).base();
+
+            return StringView(first, size_t(last - first));
+        }
+
+        /**
+         * Copies the characters into a string.
+         */
+        std::string string() const
+        {
+            return std::string(data_, size_);
+        }
+
+        /**
+         * Copies the characters into a string, so views can be passed where strings are taken.
+         */
+        operator std::string() const
+        {
+            return string();
+        }
+
+        /**
+         * Compares the characters of two views like std::string::compare.
+         */
+        static int compare(const StringView &a, const StringView &b)
+        {
+            auto size = std::min(a.size_, b.size_);
+            auto result = size != 0 ? std::memcmp(a.data_, b.data_, size) : 0;
+
+            if (result != 0)
+            {
+                return result;
+            }
+
+            return a.size_ < b.size_ ? -1 : (a.size_ > b.size_ ? 1 : 0);
+        }
+
+        /**
+         * Whether a character is whitespace in the text formats.
+         */
+        static bool isSpace(char ch)
+        {
+            return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' || ch == '\f';
+        }
+
+        friend bool operator==(const StringView &a, const StringView &b)
+        {
+            return a.size_ == b.size_ && (a.size_ == 0 || std::memcmp(a.data_, b.data_, a.size_) == 0);
+        }
+
+        friend bool operator!=(const StringView &a, const StringView &b)
+        {
+            return !(a == b);
+        }
+
+        friend bool operator<(const StringView &a, const StringView &b)
+        {
+            return compare(a, b) < 0;
+        }
+
+        friend std::ostream &operator<<(std::ostream &stream, const StringView &view)
+        {
+            return stream.write(view.data_, view.size_);
+        }
+    };
+}
+
+namespace std
+{
+    template <>
+    struct hash<Casc::StringView>
+    {
+        size_t operator()(const Casc::StringView &view) const
+        {
+            // FNV-1a, since the keys of the text formats are short.
+            uint64_t value = 14695981039346656037ULL;
+
+            for (auto ch : view)
+            {
+                value = (value ^ uint8_t(ch)) * 1099511628211ULL;
+            }
+
+            return size_t(value);
+        }
+    };
+}
\ No newline at end of file
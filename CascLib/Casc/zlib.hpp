@@ -1,9 +1,11 @@
 #pragma once
 #include <zconf.h>
 #include <zlib.h>
+#include <algorithm>
 #include <exception>
+#include <stdexcept>
 #include <string>
-#include <sstream>
+#include <vector>
 
 class ZError : public std::runtime_error
 {
@@ -30,7 +32,7 @@ public:
 	/*!
 	* @brief Constructor
 	*/
-	ZStreamBase()
+	ZStreamBase() : flush_(false), stream_end_(false)
 	{
 
 	}
@@ -84,6 +86,22 @@ public:
 	*/
 	virtual void read(char_t* buf, size_t buf_size) = 0;
 
+	/*!
+	* @brief Read as much as fits in a buffer from the ZLib stream
+	*
+	* The stream state is kept, so the next call resumes where this one stopped.
+	*
+	* @param buf pointer to the buffer
+	* @param buf_size buffer size
+	* @return the number of bytes written to the buffer
+	*/
+	size_t readSome(char_t* buf, size_t buf_size)
+	{
+		read(buf, buf_size);
+
+		return buf_size - z_stream_.avail_out;
+	}
+
 	/*!
 	* @brief Read all ZLib output stream
 	*
@@ -95,25 +113,35 @@ public:
 	*/
 	void readAll(char_t** buf, size_t& buf_size)
 	{
-		std::stringstream out_stream;
+		std::vector<char_t> out;
 
-		char_t out_buf[ChunkSize];
+		readAll(out);
 
+		buf_size = out.size();
+		*buf = new char_t[buf_size];
+		std::copy(out.begin(), out.end(), *buf);
+	}
+
+	/*!
+	* @brief Read all ZLib output stream
+	*
+	* Appends the output directly to a container of bytes.
+	*
+	* @param out the container to append to
+	*/
+	template <typename Container>
+	void readAll(Container& out)
+	{
 		do
 		{
-			read(out_buf, ChunkSize);
+			size_t used = out.size();
+			out.resize(used + ChunkSize);
 
-			size_t out_size = ChunkSize - z_stream_.avail_out;
-			out_stream.write(reinterpret_cast< const char* >(out_buf), out_size);
+			read(reinterpret_cast< char_t* >(&out[used]), ChunkSize);
 
-			if (out_stream.bad())
-				throw ZError("Error writing temporary stream");
+			out.resize(used + ChunkSize - z_stream_.avail_out);
 
 		} while (isOutEmpty());
-
-		buf_size = out_stream.str().size();
-		*buf = new char_t[buf_size];
-		out_stream.read(reinterpret_cast< std::stringstream::char_type* >(*buf), buf_size);
 	}
 
 	/*!